@@ -0,0 +1,306 @@
+/* BENCHMARKs for BITFILE */
+
+#include "bitfile.h"
+#include <time.h>
+
+/* Bench files */
+#define BENCH_FILE_R "bench.bin"
+#define BENCH_FILE_W "bench.out"
+
+/* Default largest file size (Override with 1st argument, ie. 4G) */
+#define BENCH_MAX_SIZE (16 << 20)
+/* Smallest file size & growth factor between runs */
+#define BENCH_MIN_SIZE 4096
+#define BENCH_SIZE_STEP 16
+/* Most bytes a sequential run covers, for bitfile & stdio alike (Keeps small widths on large files bounded) */
+#define BENCH_MAX_SPAN ((int64_t)64 << 20)
+/* Calls per random run */
+#define BENCH_MAX_SEEKS (1 << 16)
+/* Offset of unaligned runs (In bits) */
+#define BENCH_SKEW 3
+/* Chunk size of stdio baseline (In bytes) */
+#define BENCH_CHUNK (1 << 16)
+
+bsize_t widths[] = { 1, 3, 7, 8, 12, 13, 16, 24, 31, 32, 33, 48, 57, 63, 64 };
+
+volatile uint64_t sink;
+bool firstResult = true;
+
+double now();
+int benchFile(const char* filename, int64_t size);
+int benchRead(bool msbFirst, bsize_t width, bsize_t skew, bool random, int64_t size);
+int benchWrite(bool msbFirst, bsize_t width, bsize_t skew, int64_t size);
+int benchStdio(bool random, int64_t size);
+int benchStdioWrite(int64_t size);
+void printResult(const char* api, const char* op, const char* access, const char* order, bsize_t width, bool aligned, int64_t size, int64_t span, uint64_t calls, uint64_t bits, double seconds);
+int64_t seqSpan(int64_t size);
+int64_t parseSize(const char* str);
+
+
+/* Run all benchmarks, printing results as JSON to stdout */
+int main(int argc, char** argv)
+{
+    int64_t maxSize = argc > 1 ? parseSize(argv[1]) : BENCH_MAX_SIZE;
+    if (maxSize < BENCH_MIN_SIZE)
+    {
+        fprintf(stderr, "Usage: %s [max_size[K|M|G]] (Minimum %d)\n", argv[0], BENCH_MIN_SIZE);
+        return 1;
+    }
+    srand(1);
+
+    printf("{\n  \"benchmark\": \"bitfile\",\n  \"max_size\": %lld,\n  \"results\": [", (long long)maxSize);
+    for (int64_t size = BENCH_MIN_SIZE; size <= maxSize; size *= BENCH_SIZE_STEP)
+    {
+        fprintf(stderr, "Benchmarking %lld byte file...\n", (long long)size);
+
+        if (benchFile(BENCH_FILE_R, size)) return 1;
+        if (benchStdioWrite(size) || benchStdio(false, size) || benchStdio(true, size)) return 1;
+
+        for (int order = 0; order < 2; order++)
+        {
+            for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+            {
+                for (bsize_t skew = 0; skew <= BENCH_SKEW; skew += BENCH_SKEW)
+                {
+                    if (benchRead(order, widths[w], skew, false, size)) return 1;
+                    if (benchRead(order, widths[w], skew, true, size)) return 1;
+                    if (benchWrite(order, widths[w], skew, size)) return 1;
+                }
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    remove(BENCH_FILE_R);
+    remove(BENCH_FILE_W);
+    return 0;
+}
+
+
+
+/* --- BENCHMARKS --- */
+
+/* Fill filename with size random bytes */
+int benchFile(const char* filename, int64_t size)
+{
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        perror("Unable to create bench file");
+        return 1;
+    }
+
+    static byte_t chunk[BENCH_CHUNK];
+    for (size_t i = 0; i < BENCH_CHUNK; i++) chunk[i] = (byte_t)rand();
+
+    for (int64_t left = size; left > 0; left -= BENCH_CHUNK)
+    {
+        size_t count = left < BENCH_CHUNK ? (size_t)left : BENCH_CHUNK;
+        if (fwrite(chunk, 1, count, file) != count)
+        {
+            perror("Unable to write bench file");
+            fclose(file);
+            return 1;
+        }
+    }
+    return fclose(file) ? 1 : 0;
+}
+
+/* Baseline: fwrite whole chunks over the sequential span (Timing includes the closing flush, like benchWrite) */
+int benchStdioWrite(int64_t size)
+{
+    FILE* file = fopen(BENCH_FILE_W, "wb");
+    if (file == NULL)
+    {
+        perror("Unable to open bench output");
+        return 1;
+    }
+
+    static byte_t chunk[BENCH_CHUNK];
+    for (size_t i = 0; i < BENCH_CHUNK; i++) chunk[i] = (byte_t)rand();
+
+    int64_t span = seqSpan(size);
+    uint64_t calls = 0, bits = 0;
+    double start = now();
+
+    for (int64_t left = span; left > 0; left -= BENCH_CHUNK, calls++)
+    {
+        size_t count = left < BENCH_CHUNK ? (size_t)left : BENCH_CHUNK;
+        bits += 8 * fwrite(chunk, 1, count, file);
+    }
+    if (fclose(file))
+    {
+        perror("Unable to close bench output");
+        return 1;
+    }
+
+    printResult("stdio", "fwrite", "sequential", NULL, 8 * BENCH_CHUNK, true, size, span, calls, bits, now() - start);
+    return 0;
+}
+
+/* Baseline: fread whole chunks over the sequential span, or fseek + fread 8 bytes at random offsets */
+int benchStdio(bool random, int64_t size)
+{
+    FILE* file = fopen(BENCH_FILE_R, "rb");
+    if (file == NULL)
+    {
+        perror("Unable to open bench file");
+        return 1;
+    }
+
+    static byte_t chunk[BENCH_CHUNK];
+    int64_t span = random ? size : seqSpan(size);
+    uint64_t calls = 0, bits = 0;
+    double start = now();
+
+    if (random)
+    {
+        for (; calls < BENCH_MAX_SEEKS; calls++)
+        {
+            fseeko(file, (off_t)(((int64_t)rand() * RAND_MAX + rand()) % (size - 8)), SEEK_SET);
+            bits += 8 * fread(chunk, 1, 8, file);
+            sink += chunk[0];
+        }
+    }
+    else
+    {
+        size_t count;
+        for (int64_t left = span; left > 0 && (count = fread(chunk, 1, left < BENCH_CHUNK ? (size_t)left : BENCH_CHUNK, file)) > 0; left -= count)
+        {
+            bits += 8 * count;
+            sink += chunk[0];
+            calls++;
+        }
+    }
+
+    double seconds = now() - start;
+    fclose(file);
+    printResult("stdio", "fread", random ? "random" : "sequential", NULL,
+                random ? 64 : 8 * BENCH_CHUNK, true, size, span, calls, bits, seconds);
+    return 0;
+}
+
+/* bfread width bits per call, sequentially or after a bfseek to a random position */
+int benchRead(bool msbFirst, bsize_t width, bsize_t skew, bool random, int64_t size)
+{
+    BITFILE* bf = bfopen(BENCH_FILE_R, "r", msbFirst);
+    if (bf == NULL)
+    {
+        perror("Unable to open bench file");
+        return 1;
+    }
+
+    byte_t data[8] = { 0 };
+    bpos_t span = 8 * (bpos_t)size - width - skew;
+    uint64_t limit = random ? BENCH_MAX_SEEKS : (uint64_t)(8 * (bpos_t)seqSpan(size) - width - skew) / width;
+
+    uint64_t calls = 0;
+    double start = now();
+
+    if (!random && skew) bfseek(bf, skew, SEEK_SET);
+    for (; calls < limit; calls++)
+    {
+        if (random)
+        {
+            bpos_t pos = (((bpos_t)rand() * RAND_MAX + rand()) % span) & ~(bpos_t)7;
+            bfseek(bf, pos + skew, SEEK_SET);
+        }
+        if (bfread(data, width, bf) != width)
+        {
+            fprintf(stderr, "Bench read stopped at %"BPOS_T_STR".\n", bftell(bf));
+            bfclose(bf);
+            return 1;
+        }
+        sink += data[0];
+    }
+
+    double seconds = now() - start;
+    bfclose(bf);
+    printResult("bitfile", "bfread", random ? "random" : "sequential", msbFirst ? "msb" : "lsb",
+                width, !skew, size, random ? size : (int64_t)CEIL_DIV(skew + calls * width, 8), calls, calls * width, seconds);
+    return 0;
+}
+
+/* bfwrite width bits per call sequentially (Timing includes the closing flush) */
+int benchWrite(bool msbFirst, bsize_t width, bsize_t skew, int64_t size)
+{
+    BITFILE* bf = bfopen(BENCH_FILE_W, "w", msbFirst);
+    if (bf == NULL)
+    {
+        perror("Unable to open bench output");
+        return 1;
+    }
+
+    byte_t data[8] = { 0x5A, 0xC3, 0x96, 0x0F, 0xE1, 0x3C, 0x78, 0xA5 };
+    uint64_t limit = (8 * (uint64_t)seqSpan(size) - skew) / width;
+
+    uint64_t calls = 0;
+    double start = now();
+
+    if (skew) bfwrite(data, skew, bf);
+    for (; calls < limit; calls++)
+    {
+        data[0] += (byte_t)calls;
+        if (bfwrite(data, width, bf) != width)
+        {
+            perror("Bench write failed");
+            bfclose(bf);
+            return 1;
+        }
+    }
+    if (bfclose(bf))
+    {
+        perror("Unable to close bench output");
+        return 1;
+    }
+
+    printResult("bitfile", "bfwrite", "sequential", msbFirst ? "msb" : "lsb",
+                width, !skew, size, (int64_t)CEIL_DIV(skew + calls * width, 8), calls, calls * width, now() - start);
+    return 0;
+}
+
+
+
+/* --- HELPERS --- */
+
+/* Monotonic time in seconds */
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Bytes a sequential run over a file of size covers */
+int64_t seqSpan(int64_t size)
+{
+    return size < BENCH_MAX_SPAN ? size : BENCH_MAX_SPAN;
+}
+
+/* Print one JSON result object (order is NULL for stdio, span is bytes the run covered) */
+void printResult(const char* api, const char* op, const char* access, const char* order, bsize_t width, bool aligned, int64_t size, int64_t span, uint64_t calls, uint64_t bits, double seconds)
+{
+    printf("%s\n    { \"api\": \"%s\", \"op\": \"%s\", \"access\": \"%s\", \"order\": ", firstResult ? "" : ",", api, op, access);
+    if (order) printf("\"%s\"", order);
+    else printf("null");
+    printf(", \"width\": %"BSIZE_T_STR", \"aligned\": %s, \"size\": %lld, \"span\": %lld, \"calls\": %llu, \"bits\": %llu"
+           ", \"seconds\": %.6f, \"bits_per_sec\": %.0f, \"ns_per_call\": %.2f }",
+           width, aligned ? "true" : "false", (long long)size, (long long)span, (unsigned long long)calls, (unsigned long long)bits,
+           seconds, seconds > 0 ? bits / seconds : 0, calls ? seconds * 1e9 / calls : 0);
+    firstResult = false;
+    fflush(stdout);
+}
+
+/* Parse a byte count with an optional K, M or G suffix (Returns -1 if invalid) */
+int64_t parseSize(const char* str)
+{
+    char* end;
+    long long size = strtoll(str, &end, 10);
+    switch (*end)
+    {
+        case 'G': case 'g': size <<= 10; /* fallthrough */
+        case 'M': case 'm': size <<= 10; /* fallthrough */
+        case 'K': case 'k': size <<= 10; end++;
+    }
+    return *end || end == str ? -1 : size;
+}
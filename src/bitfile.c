@@ -1,20 +1,183 @@
 #include "bitfile.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef _POSIX_ASYNCHRONOUS_IO
+#include <aio.h>
+#endif
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
 /* --- INTERNAL MACROS & FUNCTION DEFINITIONS --- */
 
-/* Calculate bit offset within byte based on if counting most significant byte first or not */
-#define MSB_OFFSET(bit, flags) (flags & BF_FLAG_MSB ? BYTE_LEN - 1 - (bit) : bit)
-/* Calculate bit shift for partial byte writes if counting most significant byte first */
-#define MSB_SHIFT(n) ((BYTE_LEN - (n)) % BYTE_LEN)
-
-int8_t incBitOffset(BITFILE* bitfile);
-void bfgetbit(byte_t* dst, bsize_t offset, BITFILE* bitfile);
-void bfputbit(byte_t src, bsize_t offset, BITFILE* bitfile);
-int getByte(BITFILE* bitfile);
-int writeByte(BITFILE* bitfile, bool inc);
-int alignByte(BITFILE* bitfile);
+/* Mask of the lowest n bits of a word (Expects 0 < n <= BITBUF_LEN) */
+#define LOW_MASK(n) (~(uint64_t)0 >> (BITBUF_LEN - (n)))
+/* Number of whole or partial bytes spanned by n bits */
+#define BYTE_SPAN(n) (((n) + BYTE_LEN - 1) / BYTE_LEN)
+/* Minimum bits in a byte-aligned request to bypass the bit accumulator */
+#define BULK_MIN BITBUF_LEN
+/* If backend holds the entire file in _buf */
+#define IN_MEMORY(bitfile) ((bitfile)->_backend == BF_BACKEND_MMAP || (bitfile)->_backend == BF_BACKEND_MEM)
+/* Range coder interval width below which a byte is shifted out */
+#define RANGE_TOP (UINT32_C(1) << 24)
+/* Zeroed bytes after an unpack chunk (Covers the widest vector load) */
+#define PACK_PAD 16
+/* Widest value the vector kernels unpack (Value + bit offset fit a 32-bit lane) */
+#define PACK_VECTOR_MAX 25
+/* Fewest bits in a packed read worth re-reading bytes instead of using the accumulator */
+#define PACK_MIN (4 * BITBUF_LEN)
+/* BF_COUNT for code many threads may run on one bitfile at once (bfpread, bfpwrite) */
+#if BF_STATS
+#define COUNT_SHARED(bitfile, counter, n) __atomic_fetch_add(&(bitfile)->_stats.counter, (n), __ATOMIC_RELAXED)
+#else
+#define COUNT_SHARED(bitfile, counter, n) ((void)0)
+#endif
+/* Kernels for later x86-64 extensions are built alongside the baseline ones & picked for the running CPU */
+#ifdef __x86_64__
+#define X86_KERNELS
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+/* Bodies shared by several kernels or engines are inlined into each, so they get its target & fixed bit order */
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+/* Extensions used by bit kernels (BF_KERNEL_*, Negative until picked for the running CPU) */
+static int kernelSet = -1;
+
+/* State of a bitfile shared by concurrent writers */
+struct bfwriters_t {
+    /* Next bit position handed out by bfreserve */
+    bpos_t tail;
+    /* Bytes held by memory backend before sharing */
+    size_t buflen;
+    /* Descriptor status flags to restore when sharing ends */
+    int fdflags;
+    /* Spinlocks guarding bytes merged by bfpwrite (Indexed by byte offset) */
+    bool locks[BF_SHARE_LOCKS];
+};
+
+/* Second descriptor buffer read or written in the background */
+struct bfasync_t {
+#ifdef _POSIX_ASYNCHRONOUS_IO
+    /* Request reading the next window into this.buf (Or writing this.buf behind the cursor) */
+    struct aiocb request;
+#endif
+    /* Buffer being read into or written from (Swapped with the bitfile's buffer) */
+    byte_t* buf;
+    /* Buffer the bitfile had when background I/O started (Restored when it stops) */
+    byte_t* home;
+    /* File offset of the pending request (-1 if none) */
+    int64_t start;
+    /* Bytes in the pending request */
+    size_t size;
+    /* If buffers are written behind the cursor rather than read ahead of it */
+    bool write;
+};
+
+/* Read & write calls built for one bit order & direction, so they never test it (Bound by bindEngine) */
+struct bfengine_t {
+    /* bfrefillbits */
+    uint64_t (*refill)(BITFILE* bitfile, unsigned number_of_bits);
+    /* bfrefillpeek */
+    uint64_t (*peek)(BITFILE* bitfile, unsigned number_of_bits);
+    /* bfspillbits */
+    int (*spill)(BITFILE* bitfile, uint64_t value, unsigned number_of_bits);
+    /* bfread */
+    bsize_t (*read)(void* ptr, bsize_t number_of_bits, BITFILE* bitfile);
+    /* bfwrite */
+    bsize_t (*write)(void* ptr, bsize_t number_of_bits, BITFILE* bitfile);
+};
+
+void putBits(BITFILE* bitfile, uint64_t bits, uint8_t count);
+KERNEL_INLINE void putOrdered(BITFILE* bitfile, uint64_t bits, uint8_t count, bool top);
+uint64_t takeBits(BITFILE* bitfile, uint8_t count);
+KERNEL_INLINE uint64_t takeOrdered(BITFILE* bitfile, uint8_t count, bool top);
+uint8_t fillBits(BITFILE* bitfile);
+KERNEL_INLINE uint8_t fillOrdered(BITFILE* bitfile, bool msb, bool back);
+KERNEL_INLINE uint8_t fillBackOrdered(BITFILE* bitfile, bool msb);
+int loadBits(BITFILE* bitfile, uint8_t bit);
+void markEOF(BITFILE* bitfile);
+void setError(BITFILE* bitfile);
+void bindEngine(BITFILE* bitfile);
+KERNEL_INLINE uint64_t refillOrdered(BITFILE* bitfile, unsigned number_of_bits, bool msb, bool back);
+KERNEL_INLINE uint64_t peekOrdered(BITFILE* bitfile, unsigned number_of_bits, bool msb, bool back);
+KERNEL_INLINE int spillOrdered(BITFILE* bitfile, uint64_t value, unsigned number_of_bits, bool msb, bool back);
+KERNEL_INLINE bsize_t readOrdered(void* ptr, bsize_t number_of_bits, BITFILE* bitfile, bool msb, bool back);
+KERNEL_INLINE bsize_t writeOrdered(void* ptr, bsize_t number_of_bits, BITFILE* bitfile, bool msb, bool back);
+int seekBits(BITFILE* bitfile, bpos_t offset, int whence);
+uint64_t traceBegin(BITFILE* bitfile, int op);
+void traceEnd(BITFILE* bitfile, int op, uint64_t start);
+int readByte(BITFILE* bitfile);
+int readByteBack(BITFILE* bitfile);
+int peekByte(BITFILE* bitfile, bool back);
+int seekAhead(BITFILE* bitfile, bsize_t number_of_bits);
+int emitBytes(BITFILE* bitfile);
+KERNEL_INLINE int emitOrdered(BITFILE* bitfile, bool msb);
+int startWrite(BITFILE* bitfile);
+KERNEL_INLINE int startOrdered(BITFILE* bitfile, bool msb);
+int flushBits(BITFILE* bitfile);
+KERNEL_INLINE int flushOrdered(BITFILE* bitfile, bool msb);
+void initBackend(BITFILE* bitfile, uint8_t backend);
+int openFile(BITFILE* bitfile, const char* filename, const char* access, uint8_t backend);
+int mapFile(BITFILE* bitfile, const char* filename);
+int closeFile(BITFILE* bitfile);
+size_t readBytes(BITFILE* bitfile, byte_t* dst, size_t count);
+size_t clampRead(BITFILE* bitfile, int64_t offset, size_t count);
+size_t writeBytes(BITFILE* bitfile, const byte_t* src, size_t count);
+size_t preadBytes(BITFILE* bitfile, byte_t* dst, size_t count, int64_t offset);
+size_t pwriteBytes(BITFILE* bitfile, const byte_t* src, size_t count, int64_t offset);
+bsize_t pwriteBits(BITFILE* bitfile, const byte_t* input, bsize_t number_of_bits, bpos_t bit_offset);
+int mergeByte(BITFILE* bitfile, byte_t bits, byte_t keep, int64_t offset);
+int seekBytes(BITFILE* bitfile, int64_t offset, int whence);
+int64_t tellBytes(BITFILE* bitfile);
+int flushBuffer(BITFILE* bitfile);
+ssize_t loadBuffer(BITFILE* bitfile);
+int startAsync(BITFILE* bitfile, bool write);
+int stopAsync(BITFILE* bitfile);
+void requestAhead(BITFILE* bitfile, int64_t offset);
+int writeBehind(BITFILE* bitfile);
+int syncBehind(BITFILE* bitfile);
+ssize_t waitAsync(bfasync_t* async);
+int slideBuffer(BITFILE* bitfile);
+int slideBufferBack(BITFILE* bitfile);
+int setBuffer(BITFILE* bitfile, byte_t* buffer, size_t size);
+int growBuffer(BITFILE* bitfile, size_t size);
+void badAccess(BITFILE* bitfile, void* ptr, bool write);
+uint64_t takeZeros(BITFILE* bitfile);
+uint64_t getCode(BITFILE* bitfile);
+bsize_t putCode(BITFILE* bitfile, uint64_t zeros, uint64_t info, unsigned width);
+const bfhuffentry_t* lookupSym(BITFILE* bitfile, const bfhuff_t* table);
+int checkSymOrder(BITFILE* bitfile, const bfhuff_t* table);
+uint32_t reverseBits(uint32_t bits, uint8_t count);
+int shiftLow(bfrange_t* coder);
+int shiftCode(bfrange_t* coder);
+size_t readPacked(BITFILE* bitfile, uint32_t* dst32, uint64_t* dst64, size_t count, unsigned width);
+void unpackBits(const byte_t* src, uint8_t offset, size_t count, unsigned width, bool msb, uint32_t* dst);
+void unpackBits64(const byte_t* src, uint8_t offset, size_t count, unsigned width, bool msb, uint64_t* dst);
+size_t unpackVector(const byte_t* src, uint8_t offset, size_t count, unsigned width, bool msb, uint32_t* dst);
+size_t unpackScalar(const byte_t* src, uint8_t offset, size_t i, size_t count, unsigned width, bool msb, uint32_t* dst);
+uint64_t loadWord(const byte_t* src, bool msb);
+size_t writePacked(BITFILE* bitfile, const uint32_t* src32, const uint64_t* src64, size_t count, unsigned width);
+size_t packBits(BITFILE* bitfile, const uint32_t* src32, const uint64_t* src64, size_t count, unsigned width, byte_t* dst);
+size_t packVector(BITFILE* bitfile, const uint32_t* src, size_t count, unsigned width, byte_t** out);
+KERNEL_INLINE size_t packScalar(BITFILE* bitfile, const uint32_t* src32, const uint64_t* src64, size_t i, size_t count, unsigned width, byte_t** out);
+KERNEL_INLINE void appendWord(uint64_t* bitbuf, unsigned* bitcount, uint64_t bits, unsigned count, bool msb, byte_t** out);
+void appendBits(BITFILE* bitfile, uint64_t bits, uint8_t count, byte_t** out);
+void storeWord(byte_t* dst, uint64_t word, bool msb);
+int cpuKernels(void);
+int activeKernels(void);
+#ifdef X86_KERNELS
+size_t unpackAVX2(const byte_t* src, size_t count, unsigned width, bool msb, uint32_t* dst, const int8_t* shuffle, const int32_t* shift, const size_t* base);
+size_t unpackSSE41(const byte_t* src, size_t count, unsigned width, bool msb, uint32_t* dst, const int8_t* shuffle, const int32_t* shift, const size_t* base);
+size_t unpackBMI2(const byte_t* src, uint8_t offset, size_t i, size_t count, unsigned width, bool msb, uint32_t* dst);
+size_t packAVX2(BITFILE* bitfile, const uint32_t* src, size_t count, unsigned width, byte_t** out);
+size_t packSSE2(BITFILE* bitfile, const uint32_t* src, size_t count, unsigned width, byte_t** out);
+size_t packBMI2(BITFILE* bitfile, const uint32_t* src32, const uint64_t* src64, size_t i, size_t count, unsigned width, byte_t** out);
+#endif
 void bfreset(BITFILE* bitfile, bool msb_first);
-uint8_t copyByteAccessMode(const char* basic_access, char* byte_access);
+uint8_t copyByteAccessMode(const char* basic_access, char* byte_access, uint8_t* backend);
 
 
 /* --- OPEN/CLOSE FUNCTIONS --- */
@@ -22,22 +185,28 @@ uint8_t copyByteAccessMode(const char* basic_access, char* byte_access);
 BITFILE* bfopen(const char* filename, const char* access_mode, bool msb_first)
 {
     char access[ACCESS_MODE_LEN];
-    uint8_t flags = copyByteAccessMode(access_mode, access);
+    uint8_t backend;
+    uint8_t flags = copyByteAccessMode(access_mode, access, &backend);
     if (flags & BF_FLAG_ERR) return NULL;
 
-    FILE* fileobj = fopen(filename, access);
-    if (fileobj == NULL) return NULL;
-
     BITFILE* bitfile = malloc(sizeof(BITFILE));
+    if (bitfile == NULL) return NULL;
+
     bitfile->_flags = flags;
-    bitfile->_fileobj = fileobj;
+    if (openFile(bitfile, filename, access, backend))
+    {
+        free(bitfile);
+        return NULL;
+    }
     bfreset(bitfile, msb_first);
     return bitfile;
 }
 
 int bfclose(BITFILE* bitfile)
 {
-    int result = fclose(bitfile->_fileobj);
+    int result = flushBits(bitfile);
+    if (closeFile(bitfile)) result = EOF;
+    free(bitfile->_writers);
     free(bitfile);
     return result;
 }
@@ -45,11 +214,23 @@ int bfclose(BITFILE* bitfile)
 BITFILE* bfreopen(const char* filename, const char* access_mode, bool msb_first, BITFILE* bitfile)
 {
     char access[ACCESS_MODE_LEN];
-    bitfile->_flags = copyByteAccessMode(access_mode, access);
+    uint8_t backend;
+    flushBits(bitfile);
+    free(bitfile->_writers);
+    bitfile->_writers = NULL;
+    bitfile->_flags = copyByteAccessMode(access_mode, access, &backend);
     if (bitfile->_flags & BF_FLAG_ERR) return NULL;
 
-    bitfile->_fileobj = freopen(filename, access, bitfile->_fileobj);
-    if (bitfile->_fileobj == NULL) return NULL;
+    if (backend == BF_BACKEND_STDIO && bitfile->_backend == BF_BACKEND_STDIO)
+    {
+        bitfile->_fileobj = freopen(filename, access, bitfile->_fileobj);
+        if (bitfile->_fileobj == NULL) return NULL;
+    }
+    else
+    {
+        closeFile(bitfile);
+        if (openFile(bitfile, filename, access, backend)) return NULL;
+    }
 
     bfreset(bitfile, msb_first);
     return bitfile;
@@ -61,385 +242,2577 @@ BITFILE* tmpbitfile(char* nametemplate, bool msb_first)
     return bfopen(nametemplate, TMP_FILE_ACCESS, msb_first);
 }
 
-
-/* --- READ/WRITE FUNCTIONS --- */
-
-bsize_t bfread(void* ptr, bsize_t number_of_bits, BITFILE* bitfile)
+BITFILE* bfmemopen(void* buf, size_t size, const char* access_mode, bool msb_first)
 {
-    if (!(bitfile->_flags & BF_FLAG_READ))
+    char access[ACCESS_MODE_LEN];
+    uint8_t backend;
+    uint8_t flags = copyByteAccessMode(access_mode, access, &backend);
+    if (flags & BF_FLAG_ERR) return NULL;
+
+    /* Backend letters don't apply & heap buffer starts empty */
+    if (backend != BF_BACKEND_STDIO || (buf == NULL && !(flags & BF_FLAG_WRITE)))
     {
-        fread(ptr, 1, 1, bitfile->_fileobj);
-        return 0;
+        errno = EINVAL;
+        return NULL;
     }
 
-    bsize_t readCount = 0;
-    byte_t* output = ptr;
-    byte_t* endptr = output + CEIL_DIV(number_of_bits, BYTE_LEN);
-
-    output--; /* Fix for initial cycle */
+    BITFILE* bitfile = malloc(sizeof(BITFILE));
+    if (bitfile == NULL) return NULL;
+    initBackend(bitfile, BF_BACKEND_MEM);
 
-    while (readCount < number_of_bits)
+    if (buf == NULL)
     {
-        /* Increment reader & zero-out new output byte -- break on EOF */
-        if (alignByte(bitfile)) break;
-        if (readCount % BYTE_LEN == 0) *(++output) = 0x0;
-
-        /* Read bit by bit into output array */
-        bfgetbit(output, readCount++, bitfile);
+        if (!size) size = BF_BUFSIZ;
+        buf = malloc(size);
+        if (buf == NULL)
+        {
+            free(bitfile);
+            return NULL;
+        }
+        bitfile->_bufowned = true;
     }
 
-    /* Shift or Zero-out remaining bits */
-    for (int8_t b = readCount % BYTE_LEN; b < BYTE_LEN && b; b++)
+    bitfile->_buf = buf;
+    bitfile->_bufsize = size;
+    bitfile->_buflen = bitfile->_bufowned || access[0] == 'w' ? 0 : size;
+    bitfile->_bufpos = access[0] == 'a' ? bitfile->_buflen : 0;
+
+    bitfile->_flags = flags;
+    bfreset(bitfile, msb_first);
+    return bitfile;
+}
+
+void* bfmembuf(BITFILE* bitfile, size_t* size)
+{
+    if (bitfile->_backend != BF_BACKEND_MEM)
     {
-        if (bitfile->_flags & BF_FLAG_MSB) *output >>= 1;
-        else *output &= ~(0x1 << b);
+        errno = EINVAL;
+        return NULL;
     }
-    /* Zero-out remaining bytes */
-    while (++output < endptr) *output = 0x0;
 
-    return readCount;
+    flushBits(bitfile);
+    if (size != NULL) *size = bitfile->_buflen;
+    return bitfile->_buf;
 }
 
-bsize_t bfwrite(void* ptr, bsize_t number_of_bits, BITFILE* bitfile)
+
+BITFILE* bfopenrange(BITFILE* bitfile, bpos_t start_bit, bsize_t number_of_bits)
 {
-    if (!(bitfile->_flags & BF_FLAG_WRITE))
+    if (!(bitfile->_flags & BF_FLAG_READ))
     {
-        fwrite(ptr, 1, 1, bitfile->_fileobj);
-        return 0;
+        errno = EBADF;
+        return NULL;
+    }
+    if (start_bit < 0)
+    {
+        errno = EINVAL;
+        return NULL;
     }
 
-    bsize_t writeCount = 0;
-    byte_t* input = ptr;
-    byte_t* endptr = input + CEIL_DIV(number_of_bits, BYTE_LEN) - 1;
-
-    int8_t shift = 0; /* Fix for final MSB byte */
+    /* Handle reads the file itself, so pending bits are written out first */
+    if (bfflush(bitfile)) return NULL;
 
-    /* Update buffer */
-    if (alignByte(bitfile) == 2) return writeCount; /* Actual error */
+    BITFILE* range = malloc(sizeof(BITFILE));
+    if (range == NULL) return NULL;
 
-    /* Align file byte cursor */
-    if (bfeof(bitfile)) clearbferr(bitfile);
-    else if (fseek(bitfile->_fileobj, -1, SEEK_CUR)) return writeCount;
+    int64_t start = start_bit / BYTE_LEN;
+    int64_t end = number_of_bits < (bsize_t)(INT64_MAX - BYTE_LEN - start_bit) ? BYTE_SPAN(start_bit + (int64_t)number_of_bits) : INT64_MAX;
 
-    while (writeCount < number_of_bits)
+    /* Memory is shared as is, with its length cut at the end of range */
+    if (IN_MEMORY(bitfile))
+    {
+        initBackend(range, bitfile->_backend);
+        range->_buf = bitfile->_buf;
+        range->_bufsize = bitfile->_bufsize;
+        range->_buflen = (int64_t)bitfile->_buflen < end ? bitfile->_buflen : (size_t)end;
+    }
+    else
     {
-        /* Flush byte and increment writer */
-        if (bitfile->_bitoffset >= BYTE_LEN)
+        initBackend(range, BF_BACKEND_FD);
+        range->_fd = bitfile->_backend == BF_BACKEND_STDIO ? fileno(bitfile->_fileobj) : bitfile->_fd;
+
+        /* Buffer needn't outgrow the range */
+        size_t size = end - start < BF_BUFSIZ ? (size_t)(end - start) : BF_BUFSIZ;
+        if (setBuffer(range, NULL, size ? size : 1))
         {
-            if (writeByte(bitfile, true)) return writeCount;
-            bitfile->_bitoffset = 0;
+            free(range);
+            return NULL;
         }
+    }
+    range->_shared = true;
+    range->_end = end;
+    range->_flags = BF_FLAG_READ;
+    bfreset(range, bitfile->_flags & BF_FLAG_MSB);
+
+    if (bfseek(range, start_bit, SEEK_SET))
+    {
+        bfclose(range);
+        return NULL;
+    }
+    return range;
+}
 
-        /* Increment input byte & Add in bit shift to final byte */
-        if (writeCount % BYTE_LEN == 0)
+int bfsplit(BITFILE* bitfile, const bpos_t* bounds, size_t count, BITFILE** handles)
+{
+    for (size_t n = 0; n < count; n++)
+    {
+        if (bounds[n + 1] < bounds[n])
         {
-            if (writeCount) input++;
-            if (bitfile->_flags & BF_FLAG_MSB && input == endptr)
-            {
-                shift = MSB_SHIFT(number_of_bits - writeCount);
-            }
+            errno = EINVAL;
+            handles[n] = NULL;
         }
-
-        /* Write bit by bit from input array */
-        bfputbit(*input, shift + writeCount++, bitfile);
+        else handles[n] = bfopenrange(bitfile, bounds[n], bounds[n + 1] - bounds[n]);
+        if (handles[n] != NULL) continue;
+
+        /* Close handles already opened */
+        int error = errno;
+        while (n--) bfclose(handles[n]);
+        errno = error;
+        return EOF;
     }
+    return 0;
+}
 
-    /* Flush final write buffer */
-    if (writeCount && writeByte(bitfile, false)) writeCount -= bitfile->_bitoffset;
 
-    return writeCount;
-}
+/* --- READ/WRITE FUNCTIONS --- */
 
-int bfflush(BITFILE* bitfile)
+bsize_t bfread(void* ptr, bsize_t number_of_bits, BITFILE* bitfile)
 {
-    return fflush(bitfile->_fileobj);
+    uint64_t start = traceBegin(bitfile, BF_OP_READ);
+    bsize_t readCount = bitfile->_engine->read(ptr, number_of_bits, bitfile);
+    traceEnd(bitfile, BF_OP_READ, start);
+    return readCount;
 }
 
-int setbfbuf(BITFILE* bitfile, char* buffer, int mode, size_t size)
+bsize_t bfwrite(void* ptr, bsize_t number_of_bits, BITFILE* bitfile)
 {
-    if (mode == _IOLBF) return -1; /* Cannot do line buffering of bits */
-    return setvbuf(bitfile->_fileobj, buffer, mode, size);
+    uint64_t start = traceBegin(bitfile, BF_OP_WRITE);
+    bsize_t writeCount = bitfile->_engine->write(ptr, number_of_bits, bitfile);
+    traceEnd(bitfile, BF_OP_WRITE, start);
+    return writeCount;
 }
 
-/* --- POSITION FUNCTIONS --- */
-
-int bfseek(BITFILE* bitfile, bpos_t offset, int whence)
+bsize_t bfpread(BITFILE* bitfile, void* ptr, bsize_t number_of_bits, bpos_t bit_offset)
 {
-    fpos_t byte_offset = 0;
-
-    /* Include current bitOffset and fix byte offset if seeking from current position */
-    if (whence == SEEK_CUR)
+    if (!(bitfile->_flags & BF_FLAG_READ))
     {
-        offset += bitfile->_bitoffset;
-        byte_offset--;
+        badAccess(bitfile, ptr, false);
+        return 0;
     }
-
-    /* Allow bitCount to overflow */
-    while (offset >= BYTE_LEN)
+    if (bit_offset < 0)
     {
-        offset -= BYTE_LEN;
-        byte_offset++;
+        errno = EINVAL;
+        return 0;
     }
-    while (offset < 0)
+    if (!number_of_bits) return 0;
+
+    byte_t* output = ptr;
+    size_t size = BYTE_SPAN(number_of_bits);
+    int64_t start = bit_offset / BYTE_LEN;
+    uint8_t shift = bit_offset % BYTE_LEN;
+    bool msb = bitfile->_flags & BF_FLAG_MSB;
+
+    /* Read the spanned bytes into output (Byte past its end is held aside) */
+    byte_t next = 0;
+    size_t got = preadBytes(bitfile, output, size, start);
+    if (got == size && BYTE_SPAN(shift + number_of_bits) > size) got += preadBytes(bitfile, &next, 1, start + size);
+    if (got < size) memset(output + got, 0, size - got);
+
+    bsize_t readCount = (bsize_t)got * BYTE_LEN > shift ? (bsize_t)got * BYTE_LEN - shift : 0;
+    if (readCount > number_of_bits) readCount = number_of_bits;
+
+    /* Shift bytes into place (In order, so each source byte is read before it is overwritten) */
+    if (shift)
     {
-        offset += BYTE_LEN;
-        byte_offset--;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) < size; i += sizeof(uint64_t))
+        {
+            uint64_t word = loadWord(output + i, msb);
+            byte_t after = output[i + sizeof(uint64_t)];
+            if (msb) storeWord(output + i, (word << shift) | (after >> (BYTE_LEN - shift)), msb);
+            else     storeWord(output + i, (word >> shift) | ((uint64_t)after << (BITBUF_LEN - shift)), msb);
+        }
+        for (; i < size; i++)
+        {
+            byte_t after = i + 1 < size ? output[i + 1] : next;
+            if (msb) output[i] = (byte_t)((output[i] << shift) | (after >> (BYTE_LEN - shift)));
+            else     output[i] = (byte_t)((output[i] >> shift) | (after << (BYTE_LEN - shift)));
+        }
     }
-    
-    fseek(bitfile->_fileobj, byte_offset, whence);
 
-    /* Update BITFILE parameters */
-    bitfile->_bitoffset = offset;
-    if (!getByte(bitfile)) return 0;
-    bitfile->_bitoffset = 0;
-    return 1;
-}
+    /* Partial byte is stored right-aligned & the rest zeroed, like bfread */
+    size_t whole = readCount / BYTE_LEN;
+    uint8_t partial = readCount % BYTE_LEN;
+    if (partial) output[whole] = msb ? output[whole] >> (BYTE_LEN - partial) : output[whole] & (0xFF >> (BYTE_LEN - partial));
+    whole += partial > 0;
+    if (whole < size) memset(output + whole, 0, size - whole);
 
-bpos_t bftell(BITFILE* bitfile)
-{
-    return (bpos_t)ftell(bitfile->_fileobj) * (bpos_t)BYTE_LEN + bitfile->_bitoffset - BYTE_LEN;
+    COUNT_SHARED(bitfile, bits_read, readCount);
+    return readCount;
 }
 
-void bfrewind(BITFILE* bitfile)
+bsize_t bfpwrite(BITFILE* bitfile, const void* ptr, bsize_t number_of_bits, bpos_t bit_offset)
 {
-    rewind(bitfile->_fileobj);
-    bfreset(bitfile, bitfile->_flags & BF_FLAG_MSB);
+    if (!(bitfile->_flags & BF_FLAG_WRITE))
+    {
+        badAccess(bitfile, (void*)ptr, true);
+        return 0;
+    }
+    if (bit_offset < 0)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    if (!number_of_bits) return 0;
+
+    bsize_t writeCount = pwriteBits(bitfile, ptr, number_of_bits, bit_offset);
+    COUNT_SHARED(bitfile, bits_written, writeCount);
+    return writeCount;
 }
 
-int bfgetpos(BITFILE* bitfile, bfpos_t* pos)
+int bfshare(BITFILE* bitfile, bool shared)
 {
-    int result = fgetpos(bitfile->_fileobj, &pos->byte);
+    if (!(bitfile->_flags & BF_FLAG_WRITE))
+    {
+        errno = EBADF;
+        return EOF;
+    }
+    if (shared == (bitfile->_writers != NULL)) return 0;
 
-    pos->byte--; /* File cursor is always +1 from bit cursor */
-    pos->bit = bitfile->_bitoffset % BYTE_LEN;
+    int fd = bitfile->_backend == BF_BACKEND_STDIO ? fileno(bitfile->_fileobj) : bitfile->_fd;
+    bfwriters_t* writers = bitfile->_writers;
+    if (shared)
+    {
+        /* Records are written to the file itself, so pending bits are written out first */
+        if (bfflush(bitfile)) return EOF;
 
-    /* Wrap overflown bits */
-    if (!result && bitfile->_bitoffset >= BYTE_LEN) pos->byte += bitfile->_bitoffset / BYTE_LEN;
+        writers = calloc(1, sizeof(bfwriters_t));
+        if (writers == NULL) return EOF;
+        writers->tail = bftell(bitfile);
+        writers->buflen = bitfile->_buflen;
 
-    return bitfile->_bitoffset < 0 ? -1 : result;
-}
+        if (bitfile->_backend == BF_BACKEND_MEM)
+        {
+            /* Whole buffer is held (Zeroed past its contents) so records can be merged anywhere in it */
+            memset(bitfile->_buf + bitfile->_buflen, 0, bitfile->_bufsize - bitfile->_buflen);
+            bitfile->_buflen = bitfile->_bufsize;
+        }
+        else
+        {
+            /* Records are written at their own offsets, even in append mode */
+            writers->fdflags = fcntl(fd, F_GETFL);
+            if (writers->fdflags < 0 || (writers->fdflags & O_APPEND && fcntl(fd, F_SETFL, writers->fdflags & ~O_APPEND)))
+            {
+                free(writers);
+                return EOF;
+            }
+        }
+        bitfile->_writers = writers;
+        return 0;
+    }
 
-int bfsetpos(BITFILE* bitfile, const bfpos_t* pos)
-{
-    if (pos->bit < 0 || pos->bit >= BYTE_LEN)
+    int result = 0;
+    bitfile->_writers = NULL;
+    if (bitfile->_backend == BF_BACKEND_MEM)
     {
-        errno = EINVAL;
-        return 1;
+        size_t end = BYTE_SPAN(writers->tail);
+        if (end > bitfile->_bufsize) end = bitfile->_bufsize;
+        bitfile->_buflen = end > writers->buflen ? end : writers->buflen;
     }
-    
-    int result = fsetpos(bitfile->_fileobj, &pos->byte);
-    if (result) return result;
-
-    bitfile->_bitoffset = (int8_t)pos->bit;
-    return getByte(bitfile);
-}
+    else
+    {
+        if (writers->fdflags & O_APPEND && fcntl(fd, F_SETFL, writers->fdflags)) result = EOF;
 
+        /* Buffered bytes may be older than the records */
+        if (bitfile->_backend == BF_BACKEND_FD && slideBuffer(bitfile)) result = EOF;
+    }
 
-/* --- ERROR FUNCTIONS --- */
+    /* So are bits read ahead */
+    bitfile->_bitbuf = 0x0;
+    bitfile->_bitcount = 0;
+    if (bfseek(bitfile, writers->tail, SEEK_SET)) result = EOF;
 
-int bferror(BITFILE* bitfile)
-{
-    int err = ferror(bitfile->_fileobj);
-    if (err) return err;
-    if (bitfile->_flags & BF_FLAG_ERR) return 1;
-    if (bitfile->_bitoffset >= 0) return err;
-    errno = EFAULT;
-    return -1;
+    free(writers);
+    return result;
 }
 
-int bfeof(BITFILE* bitfile)
+bpos_t bfreserve(BITFILE* bitfile, bsize_t number_of_bits)
 {
-    int eof = feof(bitfile->_fileobj);
-    if (eof) return eof;
-    return bitfile->_currbyte == EOF;
+    if (bitfile->_writers == NULL)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return __atomic_fetch_add(&bitfile->_writers->tail, (bpos_t)number_of_bits, __ATOMIC_RELAXED);
 }
 
-void clearbferr(BITFILE* bitfile)
+int bfflush(BITFILE* bitfile)
 {
-    if (bitfile->_bitoffset < 0) bitfile->_bitoffset = 0;
-    if (bitfile->_currbyte == EOF) bitfile->_currbyte = 0;
-    bitfile->_flags &= ~BF_FLAG_ERR;
-    clearerr(bitfile->_fileobj);
+    uint64_t start = traceBegin(bitfile, BF_OP_FLUSH);
+    int result = flushBits(bitfile) ? EOF : flushBuffer(bitfile);
+    traceEnd(bitfile, BF_OP_FLUSH, start);
+    return result;
 }
 
-
-/* --- UTILITIES --- */
-
-void swapendian(void* bin_data, bsize_t number_of_bits)
+int bfadvise(BITFILE* bitfile, int advice)
 {
-    byte_t* data_ptr = (byte_t *)bin_data;
+    if (advice < BF_ADVISE_NORMAL || advice > BF_ADVISE_WRITEBEHIND)
+    {
+        errno = EINVAL;
+        return -1;
+    }
 
-    int offsetFactor = CEIL_DIV(number_of_bits, BYTE_LEN);
-    int half = offsetFactor / 2;
-    offsetFactor--; /* 0-index offsetter */
-    
-    /* Go through 50% of array and swap all mirrored bytes (a & b) */
-    for (int a = 0; a < half; a++)
+    if (bitfile->_backend == BF_BACKEND_FD)
     {
-        int b = offsetFactor - a;
+        bool async = advice == BF_ADVISE_READAHEAD || advice == BF_ADVISE_WRITEBEHIND;
+        if (async ? startAsync(bitfile, advice == BF_ADVISE_WRITEBEHIND) : stopAsync(bitfile)) return -1;
+    }
 
-        byte_t temp = data_ptr[a];
-        data_ptr[a] = data_ptr[b];
-        data_ptr[b] = temp;
+    /* Write-behind only changes how the descriptor buffer is written */
+    if (advice == BF_ADVISE_WRITEBEHIND || bitfile->_backend == BF_BACKEND_MEM) return 0;
+
+    if (bitfile->_backend == BF_BACKEND_MMAP)
+    {
+        const int madvice[] = { POSIX_MADV_NORMAL, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM, POSIX_MADV_WILLNEED, POSIX_MADV_SEQUENTIAL };
+        return bitfile->_bufsize ? posix_madvise(bitfile->_buf, bitfile->_bufsize, madvice[advice]) : 0;
     }
+
+#ifdef POSIX_FADV_NORMAL
+    const int fadvice[] = { POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM, POSIX_FADV_WILLNEED, POSIX_FADV_SEQUENTIAL };
+    int fd = bitfile->_backend == BF_BACKEND_STDIO ? fileno(bitfile->_fileobj) : bitfile->_fd;
+    return posix_fadvise(fd, 0, 0, fadvice[advice]);
+#else
+    return 0; /* Hint not supported */
+#endif
 }
 
-void fprintbin(FILE* stream, const void* bin_data, bsize_t number_of_bits)
+int setbfbuf(BITFILE* bitfile, char* buffer, int mode, size_t size)
 {
-    byte_t* data_ptr = (byte_t *)bin_data;
+    if (mode == _IOLBF) return -1; /* Cannot do line buffering of bits */
+    if (bitfile->_backend == BF_BACKEND_STDIO) return setvbuf(bitfile->_fileobj, buffer, mode, size);
+    if (IN_MEMORY(bitfile)) return 0; /* Memory is the buffer */
 
-    for (bsize_t j = 0; j < number_of_bits; j++)
+    /* Unbuffered descriptor still stages single bytes */
+    if (mode == _IONBF)
     {
-        if (PRINT_BYTE_SPACES && j % BYTE_LEN == 0 && j) fprintf(stream, " ");
-        int offset = (number_of_bits - 1 - j) % BYTE_LEN;
-        fprintf(stream, "%c", data_ptr[j / BYTE_LEN] & (0x1 << offset) ? '1' : '0');
+        buffer = NULL;
+        size = 1;
     }
+    if (mode != _IONBF && mode != _IOFBF) return -1;
+    if (flushBits(bitfile) || stopAsync(bitfile) || flushBuffer(bitfile)) return EOF;
+    return setBuffer(bitfile, (byte_t*)buffer, size);
 }
 
-void printbin(const void* bin_data, bsize_t number_of_bits)
+/* --- BIT FIELD FUNCTIONS --- */
+
+uint64_t bfrefillbits(BITFILE* bitfile, unsigned number_of_bits)
 {
-    fprintbin(stdout, bin_data, number_of_bits);
+    return bitfile->_engine->refill(bitfile, number_of_bits);
 }
 
+uint64_t bfrefillpeek(BITFILE* bitfile, unsigned number_of_bits)
+{
+    return bitfile->_engine->peek(bitfile, number_of_bits);
+}
 
-/* --- INTERNAL HELPERS --- */
+int bfrefillskip(BITFILE* bitfile, bsize_t number_of_bits)
+{
+    /* Seek if not reading or skipping past what one refill can hold */
+    if ((bitfile->_flags & (BF_FLAG_READ | BF_FLAG_DIRTY | BF_FLAG_EOF)) != BF_FLAG_READ ||
+        number_of_bits > (bsize_t)bitfile->_bitcount + BITBUF_LEN)
+        return seekAhead(bitfile, number_of_bits);
 
-/* Size of valid_access_chars array */
-#define VALID_ACCESS_CHARS_OUTER_SZ (ACCESS_MODE_LEN - 1)
-/* Size of valid_access_chars elements */
-#define VALID_ACCESS_CHARS_INNER_SZ 3
-/* Valid letters for each char index of access_mode */
-const char valid_access_chars[VALID_ACCESS_CHARS_OUTER_SZ][VALID_ACCESS_CHARS_INNER_SZ] = {
-    { 'r', 'w', 'a' },
-    { '+', 'b',  0  },
-    { '+', 'b',  0  },
-};
+    number_of_bits -= bitfile->_bitcount;
+    takeBits(bitfile, bitfile->_bitcount);
+    fillBits(bitfile);
 
-/* Check if val is in arr */
-bool isIn(char val, const char* arr, int arr_size)
-{
-    for (int i = 0; i < arr_size; i++)
-    {
-        if (arr[i] == val) return true;
-    }
-    return false;
+    if (number_of_bits > bitfile->_bitcount) return seekAhead(bitfile, number_of_bits);
+    takeBits(bitfile, number_of_bits);
+    return 0;
 }
 
-/* Copies the value of bit at bitfile to given offset of dst (Incrementing bit cursor) */
-void bfgetbit(byte_t* dst, bsize_t offset, BITFILE* bitfile)
+int bfspillbits(BITFILE* bitfile, uint64_t value, unsigned number_of_bits)
 {
-    byte_t dstbit = 0x1 << MSB_OFFSET(offset % BYTE_LEN,     bitfile->_flags);
-    byte_t srcbit = 0x1 << MSB_OFFSET(bitfile->_bitoffset++, bitfile->_flags);
-
-    /* Set dstbit to 1 or 0 to match srcbit */
-    if (bitfile->_currbyte & srcbit) *dst |=  dstbit;
-    else                             *dst &= ~dstbit;
+    return bitfile->_engine->spill(bitfile, value, number_of_bits);
 }
 
 
-/* Copies the value of bit at given offset of src to bitfile (Incrementing bit cursor) */
-void bfputbit(byte_t src, bsize_t offset, BITFILE* bitfile)
-{
-    byte_t srcbit = 0x1 << MSB_OFFSET(offset % BYTE_LEN,     bitfile->_flags);
-    byte_t dstbit = 0x1 << MSB_OFFSET(bitfile->_bitoffset++, bitfile->_flags);
+/* --- VARIABLE-LENGTH CODE FUNCTIONS --- */
 
-    /* Set dstbit to 1 or 0 to match srcbit */
-    if (src & srcbit) bitfile->_currbyte |=  dstbit;
-    else              bitfile->_currbyte &= ~dstbit;
+uint64_t bfgetunary(BITFILE* bitfile)
+{
+    return getCode(bitfile);
 }
 
-/* Set bitfile parameters to initial values (Doesn't modify _fileobj) */
-void bfreset(BITFILE* bitfile, bool msb_first)
+bsize_t bfputunary(BITFILE* bitfile, uint64_t value)
 {
-    bitfile->_currbyte = 0x0;
-    bitfile->_bitoffset = BYTE_LEN; /* Force read on next operation */
-    if (msb_first) bitfile->_flags |= BF_FLAG_MSB;
-    else bitfile->_flags &= ~(uint8_t)BF_FLAG_MSB;
+    return putCode(bitfile, value, 0, 0);
 }
 
-/* Return the current bit offset with while incrementing */
-int8_t incBitOffset(BITFILE* bitfile)
+uint64_t bfgetexpgolomb(BITFILE* bitfile, unsigned k)
 {
-    bitfile->_bitoffset += 1;
-    if (bitfile->_flags & BF_FLAG_MSB) return BYTE_LEN - bitfile->_bitoffset;
-    return bitfile->_bitoffset - 1;
+    if (k >= BITBUF_LEN)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+
+    /* Zero run is the number of info bits past k */
+    uint64_t zeros = getCode(bitfile);
+    if (bfeof(bitfile) || zeros + k >= BITBUF_LEN)
+    {
+        if (!bfeof(bitfile)) errno = ERANGE;
+        return 0;
+    }
+
+    uint64_t info = bfgetbits(bitfile, zeros + k);
+    return ((UINT64_C(1) << (zeros + k)) | info) - (UINT64_C(1) << k);
 }
 
-/* Reads next byte of bitfile._fileobj into bitfile._currbyte.
-    - Success: return 0
-    - EOF: return 1 and bitfile._currbyte = EOF */
-int getByte(BITFILE* bitfile)
+bsize_t bfputexpgolomb(BITFILE* bitfile, uint64_t value, unsigned k)
 {
-    int nextByte = getc(bitfile->_fileobj);
-    bitfile->_currbyte = nextByte;
-    return nextByte == EOF;
+    if (k >= BITBUF_LEN || value > UINT64_MAX - (UINT64_C(1) << k))
+    {
+        errno = k >= BITBUF_LEN ? EINVAL : ERANGE;
+        return 0;
+    }
+
+    /* Info bits are value + 2^k below its leading 1 */
+    uint64_t shifted = value + (UINT64_C(1) << k);
+    unsigned width = BITBUF_LEN - 1 - __builtin_clzll(shifted);
+    return putCode(bitfile, width - k, shifted, width);
 }
 
-/* Write byte in buffer to file
-    - 0 on success
-    - EOF on failure to write/inc
-    - 1 on failure after write */
-int writeByte(BITFILE* bitfile, bool inc)
+uint64_t bfgetgamma(BITFILE* bitfile)
 {
-    /* Write buffer to file */
-    bitfile->_currbyte = putc(bitfile->_currbyte, bitfile->_fileobj);
-    if (bfeof(bitfile)) return EOF;
+    /* Zero run is the number of bits below the leading 1 */
+    uint64_t zeros = getCode(bitfile);
+    if (bfeof(bitfile) || zeros >= BITBUF_LEN)
+    {
+        if (!bfeof(bitfile)) errno = ERANGE;
+        return 0;
+    }
+    return (UINT64_C(1) << zeros) | bfgetbits(bitfile, zeros);
+}
 
-    /* Read next byte into buffer */
-    if (inc && getByte(bitfile))
+bsize_t bfputgamma(BITFILE* bitfile, uint64_t value)
+{
+    if (!value)
     {
-        clearerr(bitfile->_fileobj);
-        bitfile->_currbyte = 0x0;
+        errno = EINVAL;
+        return 0;
     }
-    return bfeof(bitfile);
+
+    unsigned width = BITBUF_LEN - 1 - __builtin_clzll(value);
+    return putCode(bitfile, width, value, width);
 }
 
-/* Align memory byte to bitoffset */
-int alignByte(BITFILE* bitfile)
+uint64_t bfgetdelta(BITFILE* bitfile)
 {
-    if (bitfile->_bitoffset < 0)
+    /* Gamma coded length, then value below its leading 1 */
+    uint64_t length = bfgetgamma(bitfile);
+    if (bfeof(bitfile) || !length || length > BITBUF_LEN)
     {
-        if (errno == 0) errno = ESPIPE;
-        return 2; /* Cannot read */
+        if (!bfeof(bitfile)) errno = ERANGE;
+        return 0;
     }
 
-    if (bfeof(bitfile)) return 1;
+    return (UINT64_C(1) << (length - 1)) | bfgetbits(bitfile, length - 1);
+}
 
-    while (bitfile->_bitoffset >= BYTE_LEN)
+bsize_t bfputdelta(BITFILE* bitfile, uint64_t value)
+{
+    if (!value)
     {
-        bitfile->_bitoffset -= BYTE_LEN;
-        if (getByte(bitfile)) return 1; /* EOF */
+        errno = EINVAL;
+        return 0;
     }
-    return 0;
+
+    unsigned width = BITBUF_LEN - 1 - __builtin_clzll(value);
+    bsize_t count = bfputgamma(bitfile, width + 1);
+    if (!count) return 0;
+
+    if (width && bfputbits(bitfile, value, width) != (int)width) return 0;
+    return count + width;
 }
 
-/* Store access mode w/ appended 'b' in byte_access
-    - Expects: r,w,a,r+,w+,a+,rb,wb,ab,rb+,wb+,ab+,r+b,w+b,a+b
-    - Success: return appropriate read/write flags
-    - Invalid string: return 1 */
-uint8_t copyByteAccessMode(const char* basic_access, char* byte_access)
+uint64_t bfgetrice(BITFILE* bitfile, unsigned k)
 {
-    int len = strlen(basic_access);
-    if (len < 1 || len > VALID_ACCESS_CHARS_OUTER_SZ)
+    if (k >= BITBUF_LEN)
     {
         errno = EINVAL;
-        return BF_FLAG_ERR;
+        return 0;
     }
 
-    uint8_t flags = 0;
-    bool has_b = false;
-    for (int i = 0; i < len; i++)
+    uint64_t quotient = getCode(bitfile);
+    if (bfeof(bitfile) || quotient > UINT64_MAX >> k)
     {
-        if (!isIn(basic_access[i], valid_access_chars[i], VALID_ACCESS_CHARS_INNER_SZ))
-        {
-            errno = EINVAL;
-            return BF_FLAG_ERR | flags;
+        if (!bfeof(bitfile)) errno = ERANGE;
+        return 0;
+    }
+    return (quotient << k) | bfgetbits(bitfile, k);
+}
+
+bsize_t bfputrice(BITFILE* bitfile, uint64_t value, unsigned k)
+{
+    if (k >= BITBUF_LEN)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    return putCode(bitfile, value >> k, value, k);
+}
+
+
+/* --- PREFIX CODE FUNCTIONS --- */
+
+bfhuff_t* bfhuffbuild(const uint8_t* lengths, size_t symbols, bool msb_first, unsigned root_bits)
+{
+    if (!root_bits) root_bits = BF_HUFF_ROOT;
+    if (!symbols || symbols > UINT16_MAX + 1 || root_bits > 16)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* Count codes of each length */
+    uint32_t counts[BF_HUFF_MAXLEN + 1] = { 0 };
+    uint8_t maxlen = 0;
+    for (size_t i = 0; i < symbols; i++)
+    {
+        if (lengths[i] > BF_HUFF_MAXLEN)
+        {
+            errno = EINVAL;
+            return NULL;
+        }
+        counts[lengths[i]]++;
+        if (lengths[i] > maxlen) maxlen = lengths[i];
+    }
+    counts[0] = 0;
+
+    /* First canonical code of each length (Fail if lengths are over-subscribed) */
+    uint32_t next[BF_HUFF_MAXLEN + 1];
+    uint32_t code = 0;
+    for (uint8_t len = 1; len <= maxlen; len++)
+    {
+        code = (code + counts[len - 1]) << 1;
+        next[len] = code;
+        if ((uint64_t)code + counts[len] > (UINT64_C(1) << len))
+        {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+    if (!maxlen)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    bfhuff_t* table = malloc(sizeof(bfhuff_t));
+    if (table == NULL) return NULL;
+
+    uint8_t root = root_bits < maxlen ? root_bits : maxlen;
+    size_t size = (size_t)1 << root, capacity = 2 * size;
+    table->_symbols = symbols;
+    table->_maxlen = maxlen;
+    table->_rootbits = root;
+    table->_msb = msb_first;
+    table->_table = calloc(capacity, sizeof(bfhuffentry_t));
+    table->_codes = malloc(symbols * sizeof(uint32_t));
+    table->_lengths = malloc(symbols);
+    size_t* order = malloc(symbols * sizeof(size_t));
+    if (table->_table == NULL || table->_codes == NULL || table->_lengths == NULL || order == NULL)
+    {
+        free(order);
+        bfhufffree(table);
+        return NULL;
+    }
+    memcpy(table->_lengths, lengths, symbols);
+
+    /* Assign codes & sort symbols longest code first */
+    size_t first[BF_HUFF_MAXLEN + 1];
+    size_t used = 0;
+    for (uint8_t len = maxlen; len > 0; len--)
+    {
+        first[len] = used;
+        used += counts[len];
+    }
+    for (size_t i = 0; i < symbols; i++)
+    {
+        if (!lengths[i]) continue;
+        table->_codes[i] = next[lengths[i]]++;
+        order[first[lengths[i]]++] = i;
+    }
+
+    /* Insert each code, linking a sub-table (Of up to root bits) wherever the code outgrows a table
+        - Longest codes come first, so a new sub-table is sized for every code that will share it
+        - Indexes are bit reversed for LSB first tables */
+    for (size_t n = 0; n < used; n++)
+    {
+        size_t symbol = order[n];
+        uint32_t code = table->_codes[symbol];
+        uint8_t len = lengths[symbol];
+        size_t base = 0;
+        uint8_t bits = root, depth = 0;
+
+        while (len > depth + bits)
+        {
+            uint32_t index = (code >> (len - depth - bits)) & LOW_MASK(bits);
+            size_t slot = base + (msb_first ? index : reverseBits(index, bits));
+            if (!table->_table[slot].sub)
+            {
+                uint8_t sub = len - depth - bits < root ? len - depth - bits : root;
+                if (size + ((size_t)1 << sub) > capacity)
+                {
+                    bfhuffentry_t* grown = realloc(table->_table, 2 * capacity * sizeof(bfhuffentry_t));
+                    if (grown == NULL)
+                    {
+                        free(order);
+                        bfhufffree(table);
+                        return NULL;
+                    }
+                    memset(grown + capacity, 0, capacity * sizeof(bfhuffentry_t));
+                    table->_table = grown;
+                    capacity *= 2;
+                }
+                table->_table[slot] = (bfhuffentry_t){ size, depth + bits, sub };
+                size += (size_t)1 << sub;
+            }
+            depth += bits;
+            bits = table->_table[slot].sub;
+            base = table->_table[slot].value;
+        }
+
+        /* Fill every index that starts with the rest of the code */
+        uint8_t rest = len - depth;
+        uint32_t start = (code & LOW_MASK(rest)) << (bits - rest);
+        for (uint32_t index = start; index < start + (UINT32_C(1) << (bits - rest)); index++)
+        {
+            table->_table[base + (msb_first ? index : reverseBits(index, bits))] = (bfhuffentry_t){ symbol, len, 0 };
+        }
+    }
+    free(order);
+
+    /* Codes are written first bit first */
+    if (!msb_first)
+    {
+        for (size_t i = 0; i < symbols; i++) table->_codes[i] = reverseBits(table->_codes[i], lengths[i]);
+    }
+    return table;
+}
+
+void bfhufffree(bfhuff_t* table)
+{
+    if (table == NULL) return;
+    free(table->_table);
+    free(table->_codes);
+    free(table->_lengths);
+    free(table);
+}
+
+int bfdecodesym(BITFILE* bitfile, const bfhuff_t* table)
+{
+    if (checkSymOrder(bitfile, table)) return EOF;
+
+    const bfhuffentry_t* entry = lookupSym(bitfile, table);
+    if (entry == NULL || bfskipbits(bitfile, entry->length)) return EOF;
+    BF_COUNT(bitfile, bits_read, entry->length);
+    return entry->value;
+}
+
+size_t bfdecodesyms(BITFILE* bitfile, const bfhuff_t* table, uint16_t* out, size_t count)
+{
+    if (checkSymOrder(bitfile, table)) return 0;
+
+    size_t i = 0;
+    for (; i < count; i++)
+    {
+        const bfhuffentry_t* entry = lookupSym(bitfile, table);
+        if (entry == NULL || bfskipbits(bitfile, entry->length)) break;
+        BF_COUNT(bitfile, bits_read, entry->length);
+        out[i] = entry->value;
+    }
+    return i;
+}
+
+bsize_t bfencodesym(BITFILE* bitfile, const bfhuff_t* table, unsigned symbol)
+{
+    if (symbol >= table->_symbols || !table->_lengths[symbol] || !(bitfile->_flags & BF_FLAG_MSB) != !table->_msb)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+
+    uint8_t len = table->_lengths[symbol];
+    return bfputbits(bitfile, table->_codes[symbol], len) == len ? len : 0;
+}
+
+
+/* --- RANGE CODER FUNCTIONS --- */
+
+void bfprobinit(bfprob_t* probs, size_t count)
+{
+    for (size_t i = 0; i < count; i++) probs[i] = BF_PROB_INIT;
+}
+
+int bfrangeenc(bfrange_t* coder, BITFILE* bitfile)
+{
+    if (!(bitfile->_flags & BF_FLAG_WRITE))
+    {
+        badAccess(bitfile, coder, true);
+        return EOF;
+    }
+
+    coder->_bitfile = bitfile;
+    coder->_low = 0;
+    coder->_range = UINT32_MAX;
+    coder->_cache = 0;
+    coder->_cachesize = 1;
+    coder->_code = 0;
+    return 0;
+}
+
+int bfencbit(bfrange_t* coder, bfprob_t* prob, int bit)
+{
+    uint32_t bound = (coder->_range >> BF_PROB_BITS) * *prob;
+    if (!bit)
+    {
+        coder->_range = bound;
+        *prob += ((1 << BF_PROB_BITS) - *prob) >> BF_PROB_SHIFT;
+    }
+    else
+    {
+        coder->_low += bound;
+        coder->_range -= bound;
+        *prob -= *prob >> BF_PROB_SHIFT;
+    }
+
+    for (; coder->_range < RANGE_TOP; coder->_range <<= BYTE_LEN)
+    {
+        if (shiftLow(coder)) return EOF;
+    }
+    return 0;
+}
+
+int bfrangeflush(bfrange_t* coder)
+{
+    /* Push every byte of low (And the pending carry) out */
+    for (int i = 0; i < 5; i++)
+    {
+        if (shiftLow(coder)) return EOF;
+    }
+    return 0;
+}
+
+int bfrangedec(bfrange_t* coder, BITFILE* bitfile)
+{
+    if (!(bitfile->_flags & BF_FLAG_READ))
+    {
+        uint64_t bits;
+        badAccess(bitfile, &bits, false);
+        return EOF;
+    }
+
+    coder->_bitfile = bitfile;
+    coder->_range = UINT32_MAX;
+    coder->_code = 0;
+    coder->_low = 0;
+    coder->_cache = 0;
+    coder->_cachesize = 0;
+
+    /* First byte is the encoder's initial cache (Always 0) */
+    for (int i = 0; i < 5; i++)
+    {
+        if (shiftCode(coder)) return EOF;
+    }
+    return 0;
+}
+
+int bfdecbit(bfrange_t* coder, bfprob_t* prob)
+{
+    int bit;
+    uint32_t bound = (coder->_range >> BF_PROB_BITS) * *prob;
+    if (coder->_code < bound)
+    {
+        coder->_range = bound;
+        *prob += ((1 << BF_PROB_BITS) - *prob) >> BF_PROB_SHIFT;
+        bit = 0;
+    }
+    else
+    {
+        coder->_code -= bound;
+        coder->_range -= bound;
+        *prob -= *prob >> BF_PROB_SHIFT;
+        bit = 1;
+    }
+
+    for (; coder->_range < RANGE_TOP; coder->_range <<= BYTE_LEN)
+    {
+        if (shiftCode(coder)) return EOF;
+    }
+    return bit;
+}
+
+
+/* --- PACKED ARRAY FUNCTIONS --- */
+
+size_t bfreadpacked(BITFILE* bitfile, uint32_t* dst, size_t count, unsigned width)
+{
+    if (!width || width > 32)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    return readPacked(bitfile, dst, NULL, count, width);
+}
+
+size_t bfreadpacked64(BITFILE* bitfile, uint64_t* dst, size_t count, unsigned width)
+{
+    if (!width || width > BITBUF_LEN)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    return readPacked(bitfile, NULL, dst, count, width);
+}
+
+size_t bfwritepacked(BITFILE* bitfile, const uint32_t* src, size_t count, unsigned width)
+{
+    if (!width || width > 32)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    return writePacked(bitfile, src, NULL, count, width);
+}
+
+size_t bfwritepacked64(BITFILE* bitfile, const uint64_t* src, size_t count, unsigned width)
+{
+    if (!width || width > BITBUF_LEN)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    return writePacked(bitfile, NULL, src, count, width);
+}
+
+int bfkernels(int kernels)
+{
+    kernels &= cpuKernels();
+    __atomic_store_n(&kernelSet, kernels, __ATOMIC_RELAXED);
+    return kernels;
+}
+
+
+/* --- POSITION FUNCTIONS --- */
+
+int bfseek(BITFILE* bitfile, bpos_t offset, int whence)
+{
+    uint64_t start = traceBegin(bitfile, BF_OP_SEEK);
+    int result = seekBits(bitfile, offset, whence);
+    traceEnd(bitfile, BF_OP_SEEK, start);
+    return result;
+}
+
+bpos_t bftell(BITFILE* bitfile)
+{
+    bpos_t offset = (bpos_t)tellBytes(bitfile) * (bpos_t)BYTE_LEN;
+    if (bitfile->_flags & (BF_FLAG_DIRTY | BF_FLAG_BACK)) return offset + bitfile->_bitcount;
+    return offset - bitfile->_bitcount;
+}
+
+void bfrewind(BITFILE* bitfile)
+{
+    flushBits(bitfile);
+    if (bitfile->_backend == BF_BACKEND_STDIO) rewind(bitfile->_fileobj);
+    else if (!seekBytes(bitfile, 0, SEEK_SET)) bitfile->_flags &= ~(uint8_t)BF_FLAG_ERR;
+    bfreset(bitfile, bitfile->_flags & BF_FLAG_MSB);
+}
+
+int bfgetpos(BITFILE* bitfile, bfpos_t* pos)
+{
+    int result = 0;
+    if (bitfile->_backend == BF_BACKEND_STDIO) result = fgetpos(bitfile->_fileobj, &pos->byte);
+    else pos->byte = tellBytes(bitfile);
+
+    /* File cursor is behind bit cursor by the pending bits (Or bits read back) in the accumulator */
+    if (bitfile->_flags & (BF_FLAG_DIRTY | BF_FLAG_BACK))
+    {
+        pos->byte += bitfile->_bitcount / BYTE_LEN;
+        pos->bit = bitfile->_bitcount % BYTE_LEN;
+        return result;
+    }
+
+    /* File cursor is ahead of bit cursor by the bytes held in the accumulator */
+    pos->byte -= BYTE_SPAN(bitfile->_bitcount);
+    pos->bit = (BYTE_LEN - bitfile->_bitcount % BYTE_LEN) % BYTE_LEN;
+
+    return result;
+}
+
+int bfsetpos(BITFILE* bitfile, const bfpos_t* pos)
+{
+    if (pos->bit >= BYTE_LEN)
+    {
+        errno = EINVAL;
+        return 1;
+    }
+    if (flushBits(bitfile)) return 1;
+
+    int result = bitfile->_backend == BF_BACKEND_STDIO ? fsetpos(bitfile->_fileobj, &pos->byte) : seekBytes(bitfile, pos->byte, SEEK_SET);
+    if (result) return result;
+
+    return loadBits(bitfile, pos->bit);
+}
+
+int bfreverse(BITFILE* bitfile, bool backward)
+{
+    if (!(bitfile->_flags & BF_FLAG_READ))
+    {
+        uint64_t bits;
+        badAccess(bitfile, &bits, false);
+        return 1;
+    }
+    if (flushBits(bitfile)) return 1;
+    if (!(bitfile->_flags & BF_FLAG_BACK) == !backward) return 0;
+
+    /* Reload the accumulator facing the other way */
+    bpos_t offset = bftell(bitfile);
+    if (backward) bitfile->_flags |= BF_FLAG_BACK;
+    else bitfile->_flags &= ~(uint8_t)BF_FLAG_BACK;
+    bindEngine(bitfile);
+    return bfseek(bitfile, offset, SEEK_SET);
+}
+
+
+/* --- ERROR FUNCTIONS --- */
+
+int bferror(BITFILE* bitfile)
+{
+    if (bitfile->_backend == BF_BACKEND_STDIO)
+    {
+        int err = ferror(bitfile->_fileobj);
+        if (err) return err;
+    }
+    return (bitfile->_flags & BF_FLAG_ERR) != 0;
+}
+
+int bfeof(BITFILE* bitfile)
+{
+    return (bitfile->_flags & BF_FLAG_EOF) != 0;
+}
+
+void clearbferr(BITFILE* bitfile)
+{
+    bitfile->_flags &= ~(uint8_t)(BF_FLAG_ERR | BF_FLAG_EOF);
+    if (bitfile->_backend == BF_BACKEND_STDIO) clearerr(bitfile->_fileobj);
+}
+
+
+/* --- STATISTICS FUNCTIONS --- */
+
+int bfstats(BITFILE* bitfile, bfstats_t* stats)
+{
+#if BF_STATS
+    memcpy(stats, &bitfile->_stats, sizeof(*stats));
+    return 0;
+#else
+    (void)bitfile;
+    memset(stats, 0, sizeof(*stats));
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+void clearbfstats(BITFILE* bitfile)
+{
+    memset(&bitfile->_stats, 0, sizeof(bitfile->_stats));
+    memset(&bitfile->_latency, 0, sizeof(bitfile->_latency));
+}
+
+int bftrace(BITFILE* bitfile, bftrace_t callback, void* arg)
+{
+#if BF_STATS
+    bitfile->_trace = callback;
+    bitfile->_tracearg = arg;
+    return 0;
+#else
+    (void)bitfile;
+    (void)callback;
+    (void)arg;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+int bftimeops(BITFILE* bitfile, bool timed)
+{
+#if BF_STATS
+    bitfile->_timed = timed;
+    return 0;
+#else
+    (void)bitfile;
+    (void)timed;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+int bflatency(BITFILE* bitfile, bflatency_t* latency)
+{
+#if BF_STATS
+    memcpy(latency, &bitfile->_latency, sizeof(*latency));
+    return 0;
+#else
+    (void)bitfile;
+    memset(latency, 0, sizeof(*latency));
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+
+/* --- UTILITIES --- */
+
+void swapendian(void* bin_data, bsize_t number_of_bits)
+{
+    byte_t* data_ptr = (byte_t *)bin_data;
+
+    int offsetFactor = CEIL_DIV(number_of_bits, BYTE_LEN);
+    int half = offsetFactor / 2;
+    offsetFactor--; /* 0-index offsetter */
+    
+    /* Go through 50% of array and swap all mirrored bytes (a & b) */
+    for (int a = 0; a < half; a++)
+    {
+        int b = offsetFactor - a;
+
+        byte_t temp = data_ptr[a];
+        data_ptr[a] = data_ptr[b];
+        data_ptr[b] = temp;
+    }
+}
+
+void fprintbin(FILE* stream, const void* bin_data, bsize_t number_of_bits)
+{
+    byte_t* data_ptr = (byte_t *)bin_data;
+
+    for (bsize_t j = 0; j < number_of_bits; j++)
+    {
+        if (PRINT_BYTE_SPACES && j % BYTE_LEN == 0 && j) fprintf(stream, " ");
+        int offset = (number_of_bits - 1 - j) % BYTE_LEN;
+        fprintf(stream, "%c", data_ptr[j / BYTE_LEN] & (0x1 << offset) ? '1' : '0');
+    }
+}
+
+void printbin(const void* bin_data, bsize_t number_of_bits)
+{
+    fprintbin(stdout, bin_data, number_of_bits);
+}
+
+
+/* --- INTERNAL HELPERS --- */
+
+/* Size of valid_access_chars array */
+#define VALID_ACCESS_CHARS_OUTER_SZ (ACCESS_MODE_LEN - 1)
+/* Size of valid_access_chars elements */
+#define VALID_ACCESS_CHARS_INNER_SZ 4
+/* Valid letters for each char index of access_mode */
+const char valid_access_chars[VALID_ACCESS_CHARS_OUTER_SZ][VALID_ACCESS_CHARS_INNER_SZ] = {
+    { 'r', 'w', 'a',  0  },
+    { '+', 'b', 'd', 'm' },
+    { '+', 'b', 'd', 'm' },
+    { '+', 'b', 'd', 'm' },
+};
+
+/* Check if val is in arr */
+bool isIn(char val, const char* arr, int arr_size)
+{
+    for (int i = 0; i < arr_size; i++)
+    {
+        if (arr[i] == val) return true;
+    }
+    return false;
+}
+
+/* Set bitfile parameters to initial values (Doesn't modify backend) */
+void bfreset(BITFILE* bitfile, bool msb_first)
+{
+    bitfile->_bitbuf = 0x0;
+    bitfile->_bitcount = 0;
+    bitfile->_flags &= ~(uint8_t)BF_FLAG_EOF;
+    if (msb_first) bitfile->_flags |= BF_FLAG_MSB;
+    else bitfile->_flags &= ~(uint8_t)BF_FLAG_MSB;
+    bindEngine(bitfile);
+}
+
+/* Read a field the accumulator can't supply alone (Engine body of bfrefillbits) */
+KERNEL_INLINE uint64_t refillOrdered(BITFILE* bitfile, unsigned number_of_bits, bool msb, bool back)
+{
+    bool top = msb != back;
+
+    if (number_of_bits > BITBUF_LEN)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    if (!(bitfile->_flags & BF_FLAG_READ))
+    {
+        uint64_t bits;
+        badAccess(bitfile, &bits, false);
+        return 0;
+    }
+    if (!number_of_bits || flushOrdered(bitfile, msb) || bfeof(bitfile)) return 0;
+
+    if (bitfile->_bitcount < number_of_bits) fillOrdered(bitfile, msb, back);
+    if (bitfile->_bitcount >= number_of_bits)
+    {
+        BF_COUNT(bitfile, bits_read, number_of_bits);
+        return takeOrdered(bitfile, number_of_bits, top);
+    }
+
+    /* Field straddles a refill (Or runs into EOF) */
+    uint8_t head = bitfile->_bitcount;
+    uint64_t bits = takeOrdered(bitfile, head, top);
+
+    fillOrdered(bitfile, msb, back);
+    uint8_t tail = number_of_bits - head;
+    if (tail > bitfile->_bitcount) tail = bitfile->_bitcount;
+
+    uint64_t rest = takeOrdered(bitfile, tail, top);
+    if (head + tail < number_of_bits) markEOF(bitfile);
+    BF_COUNT(bitfile, bits_read, head + tail);
+
+    if (!head) return rest;
+    if (top) return (bits << tail) | rest;
+    return bits | (rest << head);
+}
+
+/* Peek at a field the accumulator can't supply alone (Engine body of bfrefillpeek) */
+KERNEL_INLINE uint64_t peekOrdered(BITFILE* bitfile, unsigned number_of_bits, bool msb, bool back)
+{
+    bool top = msb != back;
+
+    if (number_of_bits > BITBUF_LEN)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    if (!(bitfile->_flags & BF_FLAG_READ))
+    {
+        uint64_t bits;
+        badAccess(bitfile, &bits, false);
+        return 0;
+    }
+    if (!number_of_bits || flushOrdered(bitfile, msb) || bfeof(bitfile)) return 0;
+
+    if (bitfile->_bitcount < number_of_bits) fillOrdered(bitfile, msb, back);
+
+    /* Peek at the front of the accumulator */
+    uint8_t head = bitfile->_bitcount < number_of_bits ? bitfile->_bitcount : number_of_bits;
+    if (!head) return 0;
+
+    uint64_t bits = top ? bitfile->_bitbuf >> (BITBUF_LEN - head) : bitfile->_bitbuf & LOW_MASK(head);
+    if (head == number_of_bits) return bits;
+
+    /* Field runs into the byte after the accumulator (Before it if reading backward, or past EOF) */
+    uint8_t tail = number_of_bits - head;
+    uint64_t rest = 0;
+    if (tail <= BYTE_LEN)
+    {
+        int byte = peekByte(bitfile, back);
+        if (byte == EOF) byte = 0x0;
+        rest = top ? (uint64_t)byte >> (BYTE_LEN - tail) : (uint64_t)byte & LOW_MASK(tail);
+    }
+
+    if (top) return (bits << tail) | rest;
+    return bits | (rest << head);
+}
+
+/* Write a field the accumulator can't take alone (Engine body of bfspillbits) */
+KERNEL_INLINE int spillOrdered(BITFILE* bitfile, uint64_t value, unsigned number_of_bits, bool msb, bool back)
+{
+    bool top = msb != back;
+
+    if (number_of_bits > BITBUF_LEN)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    if (!(bitfile->_flags & BF_FLAG_WRITE))
+    {
+        badAccess(bitfile, &value, true);
+        return 0;
+    }
+    if (!number_of_bits || startOrdered(bitfile, msb)) return 0;
+
+    unsigned count = number_of_bits;
+    while (count)
+    {
+        /* Make room by writing whole bytes out of the accumulator */
+        if (bitfile->_bitcount + count > BITBUF_LEN && emitOrdered(bitfile, msb)) break;
+
+        /* Field may straddle a word */
+        uint8_t size = BITBUF_LEN - bitfile->_bitcount;
+        if (size > count) size = count;
+
+        if (msb) putOrdered(bitfile, (value >> (count - size)) & LOW_MASK(size), size, top);
+        else
+        {
+            putOrdered(bitfile, value & LOW_MASK(size), size, top);
+            value = size < BITBUF_LEN ? value >> size : 0;
+        }
+        count -= size;
+    }
+    BF_COUNT(bitfile, bits_written, number_of_bits - count);
+    return number_of_bits - count;
+}
+
+/* Read number_of_bits at the cursor into ptr (Engine body of bfread)
+    - Returns number of bits read */
+KERNEL_INLINE bsize_t readOrdered(void* ptr, bsize_t number_of_bits, BITFILE* bitfile, bool msb, bool back)
+{
+    bool top = msb != back;
+
+    if (!(bitfile->_flags & BF_FLAG_READ))
+    {
+        badAccess(bitfile, ptr, false);
+        return 0;
+    }
+    if (back)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+
+    bsize_t readCount = 0;
+    byte_t* output = ptr;
+    byte_t* endptr = output + CEIL_DIV(number_of_bits, BYTE_LEN);
+
+    /* Write out pending bits before reading them back */
+    if (flushOrdered(bitfile, msb)) number_of_bits = 0;
+
+    while (readCount < number_of_bits && !bfeof(bitfile))
+    {
+        /* Byte-aligned & accumulator drained: read whole bytes straight into output */
+        if (!bitfile->_bitcount && number_of_bits - readCount >= BULK_MIN)
+        {
+            size_t count = readBytes(bitfile, output, (number_of_bits - readCount) / BYTE_LEN);
+            output += count;
+            readCount += (bsize_t)count * BYTE_LEN;
+            if (readCount == number_of_bits) break;
+        }
+
+        /* Refill accumulator a word at a time */
+        if (bitfile->_bitcount < BYTE_LEN) fillOrdered(bitfile, msb, back);
+
+        /* Take as many whole output bytes as the accumulator holds (Or the final partial byte) */
+        bsize_t width = number_of_bits - readCount;
+        if (width > bitfile->_bitcount) width = bitfile->_bitcount;
+        if (width >= BYTE_LEN) width -= width % BYTE_LEN;
+        if (!width)
+        {
+            markEOF(bitfile);
+            break;
+        }
+
+        uint64_t bits = takeOrdered(bitfile, width, top);
+        readCount += width;
+
+        /* Split word into output bytes (Partial byte is stored right-aligned) */
+        if (width < BYTE_LEN) *(output++) = (byte_t)bits;
+        else if (msb)
+        {
+            for (int8_t shift = width - BYTE_LEN; shift >= 0; shift -= BYTE_LEN) *(output++) = (byte_t)(bits >> shift);
+        }
+        else
+        {
+            for (int8_t shift = 0; shift < (int8_t)width; shift += BYTE_LEN) *(output++) = (byte_t)(bits >> shift);
+        }
+    }
+
+    /* Zero-out remaining bytes */
+    while (output < endptr) *(output++) = 0x0;
+
+    BF_COUNT(bitfile, bits_read, readCount);
+    return readCount;
+}
+
+/* Write number_of_bits from ptr at the cursor (Engine body of bfwrite)
+    - Returns number of bits written */
+KERNEL_INLINE bsize_t writeOrdered(void* ptr, bsize_t number_of_bits, BITFILE* bitfile, bool msb, bool back)
+{
+    bool top = msb != back;
+
+    if (!(bitfile->_flags & BF_FLAG_WRITE))
+    {
+        badAccess(bitfile, ptr, true);
+        return 0;
+    }
+
+    bsize_t writeCount = 0;
+    byte_t* input = ptr;
+
+    if (!number_of_bits || startOrdered(bitfile, msb)) return writeCount;
+
+    while (writeCount < number_of_bits)
+    {
+        /* Byte-aligned: write accumulator then whole bytes straight from input */
+        if (bitfile->_bitcount % BYTE_LEN == 0 && number_of_bits - writeCount >= BULK_MIN)
+        {
+            if (emitOrdered(bitfile, msb)) break;
+
+            size_t size = (number_of_bits - writeCount) / BYTE_LEN;
+            size_t count = writeBytes(bitfile, input, size);
+            input += count;
+            writeCount += (bsize_t)count * BYTE_LEN;
+            if (count < size || writeCount == number_of_bits) break;
+        }
+
+        /* Gather up to 7 input bytes (Final partial byte is stored right-aligned) */
+        bsize_t width = number_of_bits - writeCount;
+        if (width > BITBUF_LEN - BYTE_LEN) width = BITBUF_LEN - BYTE_LEN;
+
+        uint64_t bits = 0x0;
+        for (bsize_t b = 0; b < width; b += BYTE_LEN)
+        {
+            uint8_t size = width - b < BYTE_LEN ? width - b : BYTE_LEN;
+            uint64_t value = *(input++) & LOW_MASK(size);
+
+            if (msb) bits = (bits << size) | value;
+            else     bits |= value << b;
+        }
+
+        /* Make room by writing whole bytes out of the accumulator */
+        if (bitfile->_bitcount + width > BITBUF_LEN && emitOrdered(bitfile, msb)) break;
+
+        putOrdered(bitfile, bits, width, top);
+        writeCount += width;
+    }
+
+    BF_COUNT(bitfile, bits_written, writeCount);
+    return writeCount;
+}
+
+/* Engine calls for one bit order & direction, built from the bodies above with msb & back fixed */
+#define ENGINE(name, msb, back) \
+    uint64_t refill##name(BITFILE* bitfile, unsigned number_of_bits) { return refillOrdered(bitfile, number_of_bits, msb, back); } \
+    uint64_t peek##name(BITFILE* bitfile, unsigned number_of_bits) { return peekOrdered(bitfile, number_of_bits, msb, back); } \
+    int spill##name(BITFILE* bitfile, uint64_t value, unsigned number_of_bits) { return spillOrdered(bitfile, value, number_of_bits, msb, back); } \
+    bsize_t read##name(void* ptr, bsize_t number_of_bits, BITFILE* bitfile) { return readOrdered(ptr, number_of_bits, bitfile, msb, back); } \
+    bsize_t write##name(void* ptr, bsize_t number_of_bits, BITFILE* bitfile) { return writeOrdered(ptr, number_of_bits, bitfile, msb, back); }
+
+ENGINE(Lsb, false, false)
+ENGINE(Msb, true, false)
+ENGINE(LsbBack, false, true)
+ENGINE(MsbBack, true, true)
+
+/* Engines indexed by BF_FLAG_MSB (1) & BF_FLAG_BACK (2) */
+const bfengine_t engines[4] = {
+    { refillLsb, peekLsb, spillLsb, readLsb, writeLsb },
+    { refillMsb, peekMsb, spillMsb, readMsb, writeMsb },
+    { refillLsbBack, peekLsbBack, spillLsbBack, readLsbBack, writeLsbBack },
+    { refillMsbBack, peekMsbBack, spillMsbBack, readMsbBack, writeMsbBack },
+};
+
+/* Bind the read & write engine matching the bit order & direction in _flags */
+void bindEngine(BITFILE* bitfile)
+{
+    bitfile->_engine = &engines[(bitfile->_flags & BF_FLAG_MSB ? 1 : 0) | (bitfile->_flags & BF_FLAG_BACK ? 2 : 0)];
+}
+
+/* Move the bit cursor offset bits from whence (For bfseek)
+    - Success: return 0 */
+int seekBits(BITFILE* bitfile, bpos_t offset, int whence)
+{
+    if (flushBits(bitfile)) return 1;
+
+    /* Seeks that land within the bits read ahead only drop bits from the accumulator
+        - Not SEEK_SET with stdio, where finding the current position costs as much as the seek */
+    if ((bitfile->_flags & (BF_FLAG_READ | BF_FLAG_EOF)) == BF_FLAG_READ &&
+        (whence == SEEK_CUR || (whence == SEEK_SET && bitfile->_backend != BF_BACKEND_STDIO)))
+    {
+        bpos_t ahead = whence == SEEK_CUR ? offset : offset - bftell(bitfile);
+        if (bitfile->_flags & BF_FLAG_BACK) ahead = -ahead;
+        if (ahead >= 0 && ahead <= bitfile->_bitcount)
+        {
+            takeBits(bitfile, ahead);
+            return 0;
+        }
+    }
+
+    /* Include bits read ahead of the cursor (Behind it if reading backward) if seeking from current position */
+    if (whence == SEEK_CUR) offset += bitfile->_flags & BF_FLAG_BACK ? bitfile->_bitcount : -(bpos_t)bitfile->_bitcount;
+
+    /* Split into whole bytes & bit offset within byte (Rounding toward start of file) */
+    int64_t byte_offset = offset / BYTE_LEN;
+    int bit = offset % BYTE_LEN;
+    if (bit < 0)
+    {
+        bit += BYTE_LEN;
+        byte_offset--;
+    }
+
+    if (seekBytes(bitfile, byte_offset, whence)) return 1;
+
+    /* Update BITFILE parameters */
+    return loadBits(bitfile, bit);
+}
+
+/* Append count right-aligned bits to the end of the bit accumulator (Expects _bitcount + count <= BITBUF_LEN) */
+void putBits(BITFILE* bitfile, uint64_t bits, uint8_t count)
+{
+    putOrdered(bitfile, bits, count, BF_TOP_FIRST(bitfile->_flags));
+}
+
+/* putBits for a known bit order (top: Bits are packed from the top of the accumulator) */
+KERNEL_INLINE void putOrdered(BITFILE* bitfile, uint64_t bits, uint8_t count, bool top)
+{
+    if (!count) return;
+
+    if (top) bitfile->_bitbuf |= bits << (BITBUF_LEN - count - bitfile->_bitcount);
+    else     bitfile->_bitbuf |= bits << bitfile->_bitcount;
+    bitfile->_bitcount += count;
+}
+
+/* Remove count bits from the front of the bit accumulator (Expects count <= _bitcount)
+    - Returns bits right-aligned, first bit read is most significant if MSB first (Last bit read if reading backward) */
+uint64_t takeBits(BITFILE* bitfile, uint8_t count)
+{
+    return takeOrdered(bitfile, count, BF_TOP_FIRST(bitfile->_flags));
+}
+
+/* takeBits for a known bit order (top: Bits are taken from the top of the accumulator) */
+KERNEL_INLINE uint64_t takeOrdered(BITFILE* bitfile, uint8_t count, bool top)
+{
+    if (!count) return 0;
+
+    uint64_t bits;
+    if (top)
+    {
+        bits = bitfile->_bitbuf >> (BITBUF_LEN - count);
+        bitfile->_bitbuf = count < BITBUF_LEN ? bitfile->_bitbuf << count : 0;
+    }
+    else
+    {
+        bits = bitfile->_bitbuf & LOW_MASK(count);
+        bitfile->_bitbuf = count < BITBUF_LEN ? bitfile->_bitbuf >> count : 0;
+    }
+    bitfile->_bitcount -= count;
+    return bits;
+}
+
+/* Top up the bit accumulator with as many whole bytes as fit in one read
+    - Returns number of bits now held (Fewer than requested at EOF) */
+uint8_t fillBits(BITFILE* bitfile)
+{
+    return fillOrdered(bitfile, bitfile->_flags & BF_FLAG_MSB, bitfile->_flags & BF_FLAG_BACK);
+}
+
+/* fillBits for a known bit order & direction */
+KERNEL_INLINE uint8_t fillOrdered(BITFILE* bitfile, bool msb, bool back)
+{
+    if (back) return fillBackOrdered(bitfile, msb);
+    bool top = msb;
+
+    size_t count = (BITBUF_LEN - bitfile->_bitcount) / BYTE_LEN;
+    uint64_t word;
+
+    /* Load straight from the byte buffer while it holds a whole word */
+    if (bitfile->_backend != BF_BACKEND_STDIO && bitfile->_bufpos + sizeof(word) <= bitfile->_buflen)
+    {
+        word = loadWord(bitfile->_buf + bitfile->_bufpos, msb);
+        if (!(msb) && count < sizeof(word)) word &= LOW_MASK(count * BYTE_LEN + !count);
+        bitfile->_bufpos += count;
+        BF_COUNT(bitfile, bytes_read, count);
+    }
+    else
+    {
+        byte_t bytes[BITBUF_LEN / BYTE_LEN] = { 0 };
+        count = readBytes(bitfile, bytes, count);
+        word = loadWord(bytes, msb);
+    }
+    if (!count) return bitfile->_bitcount;
+
+    /* Append all bytes read as one word */
+    uint8_t size = count * BYTE_LEN;
+    putOrdered(bitfile, msb ? word >> (BITBUF_LEN - size) : word, size, top);
+    return bitfile->_bitcount;
+}
+
+/* fillBits reading backward: top up the bit accumulator with as many whole bytes before it as fit
+    - Returns number of bits now held (Fewer than requested at start of file) */
+KERNEL_INLINE uint8_t fillBackOrdered(BITFILE* bitfile, bool msb)
+{
+    bool top = !msb;
+
+    int64_t end = tellBytes(bitfile);
+    size_t count = (BITBUF_LEN - bitfile->_bitcount) / BYTE_LEN;
+    if (end < (int64_t)count) count = end > 0 ? end : 0;
+    if (!count) return bitfile->_bitcount;
+
+    /* Descriptor buffer is refilled with the bytes ending at the cursor, so later refills hit it */
+    if (bitfile->_backend == BF_BACKEND_FD && bitfile->_bufpos < count) slideBufferBack(bitfile);
+
+    byte_t bytes[BITBUF_LEN / BYTE_LEN] = { 0 };
+    if (bitfile->_backend != BF_BACKEND_STDIO && count <= bitfile->_bufpos && bitfile->_bufpos <= bitfile->_buflen)
+    {
+        bitfile->_bufpos -= count;
+        memcpy(bytes, bitfile->_buf + bitfile->_bufpos, count);
+        BF_COUNT(bitfile, bytes_read, count);
+    }
+    else
+    {
+        /* Bytes past EOF read as 0 */
+        if (seekBytes(bitfile, end - count, SEEK_SET)) return bitfile->_bitcount;
+        readBytes(bitfile, bytes, count);
+        if (seekBytes(bitfile, end - count, SEEK_SET)) return bitfile->_bitcount;
+    }
+
+    /* Prepend all bytes read as one word */
+    uint8_t size = count * BYTE_LEN;
+    uint64_t word = loadWord(bytes, msb);
+    putOrdered(bitfile, msb ? word >> (BITBUF_LEN - size) : word, size, top);
+    return bitfile->_bitcount;
+}
+
+/* Reload bit accumulator from the file cursor, skipping bit offset within first byte
+    - Byte-aligned cursors are left empty until the next read
+    - Reading backward: holds only the bits of the cursor's byte before bit offset
+    - Success: return 0
+    - Failure: return 1 (Past EOF: sets EOF & parks cursor on the missing byte, like getc) */
+int loadBits(BITFILE* bitfile, uint8_t bit)
+{
+    bitfile->_bitbuf = 0x0;
+    bitfile->_bitcount = 0;
+    bitfile->_flags &= ~(uint8_t)BF_FLAG_EOF;
+    if (!bit) return 0;
+
+    if (bitfile->_flags & BF_FLAG_BACK)
+    {
+        if (seekBytes(bitfile, 1, SEEK_CUR) || fillBits(bitfile) < BYTE_LEN) return 1;
+        takeBits(bitfile, BYTE_LEN - bit);
+        return 0;
+    }
+
+    if (!fillBits(bitfile))
+    {
+        if (bferror(bitfile)) return 1;
+        markEOF(bitfile);
+        bitfile->_bitcount = BYTE_LEN;
+        return 1;
+    }
+    takeBits(bitfile, bit);
+    return 0;
+}
+
+/* Set EOF with the cursor after the last bit read (Start of file if reading backward) */
+void markEOF(BITFILE* bitfile)
+{
+    bitfile->_bitbuf = 0x0;
+    bitfile->_bitcount = 0;
+    bitfile->_flags |= BF_FLAG_EOF;
+    BF_COUNT(bitfile, eofs, 1);
+}
+
+/* Set the error indicator */
+void setError(BITFILE* bitfile)
+{
+    bitfile->_flags |= BF_FLAG_ERR;
+    BF_COUNT(bitfile, errors, 1);
+}
+
+/* Call the trace hook at the start of a traced call (Does nothing unless BF_STATS)
+    - Returns start time in ns if the call is timed */
+uint64_t traceBegin(BITFILE* bitfile, int op)
+{
+#if BF_STATS
+    if (bitfile->_trace != NULL) bitfile->_trace(bitfile, op, false, bitfile->_tracearg);
+    if (!bitfile->_timed) return 0;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+    (void)bitfile;
+    (void)op;
+    return 0;
+#endif
+}
+
+/* Add the duration of a traced call to its latency histogram & call the trace hook at its end */
+void traceEnd(BITFILE* bitfile, int op, uint64_t start)
+{
+#if BF_STATS
+    if (bitfile->_timed)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t ns = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec - start;
+
+        /* Bucket n holds durations of 2^(n-1) up to 2^n - 1 ns */
+        unsigned bucket = ns ? BITBUF_LEN - __builtin_clzll(ns) : 0;
+        if (bucket >= BF_LATENCY_BUCKETS) bucket = BF_LATENCY_BUCKETS - 1;
+
+        bflatency_t* latency = &bitfile->_latency;
+        latency->buckets[op][bucket]++;
+        latency->total_ns[op] += ns;
+        if (ns > latency->max_ns[op]) latency->max_ns[op] = ns;
+    }
+    if (bitfile->_trace != NULL) bitfile->_trace(bitfile, op, true, bitfile->_tracearg);
+#else
+    (void)bitfile;
+    (void)op;
+    (void)start;
+#endif
+}
+
+/* Read byte at file cursor without moving the cursor
+    - Returns byte, 0 if past EOF or file is write-only, EOF on failure */
+int readByte(BITFILE* bitfile)
+{
+    if (!(bitfile->_flags & BF_FLAG_READ)) return 0x0;
+
+    byte_t byte;
+    if (readBytes(bitfile, &byte, 1)) return seekBytes(bitfile, -1, SEEK_CUR) ? EOF : byte;
+    if (bferror(bitfile)) return EOF;
+
+    if (bitfile->_backend == BF_BACKEND_STDIO) clearerr(bitfile->_fileobj);
+    return seekBytes(bitfile, 0, SEEK_CUR) ? EOF : 0x0;
+}
+
+/* Read byte before file cursor without moving the cursor
+    - Returns byte, EOF at start of file or on failure */
+int readByteBack(BITFILE* bitfile)
+{
+    if (tellBytes(bitfile) <= 0 || seekBytes(bitfile, -1, SEEK_CUR)) return EOF;
+
+    int byte = readByte(bitfile);
+    return seekBytes(bitfile, 1, SEEK_CUR) ? EOF : byte;
+}
+
+/* Look at the byte after file cursor (Before it if back) without moving the cursor
+    - Buffered backends read it in place, stdio reading forward pushes it back so the stream keeps its buffer
+    - Returns byte, 0 if past EOF, EOF at start of file or on failure */
+int peekByte(BITFILE* bitfile, bool back)
+{
+    if (bitfile->_backend != BF_BACKEND_STDIO)
+    {
+        if (back && bitfile->_bufpos > 0 && bitfile->_bufpos <= bitfile->_buflen) return bitfile->_buf[bitfile->_bufpos - 1];
+        if (!back && bitfile->_bufpos < bitfile->_buflen) return bitfile->_buf[bitfile->_bufpos];
+    }
+    else if (!back)
+    {
+        int byte = getc(bitfile->_fileobj);
+        BF_COUNT(bitfile, stdio_calls, 1);
+        if (byte != EOF) return ungetc(byte, bitfile->_fileobj);
+        if (ferror(bitfile->_fileobj)) return EOF;
+
+        clearerr(bitfile->_fileobj);
+        return 0x0;
+    }
+    return back ? readByteBack(bitfile) : readByte(bitfile);
+}
+
+/* Move the cursor number_of_bits in the direction bits are read
+    - Returns 0 on success, same as bfseek */
+int seekAhead(BITFILE* bitfile, bsize_t number_of_bits)
+{
+    bpos_t offset = (bpos_t)number_of_bits;
+    return bfseek(bitfile, bitfile->_flags & BF_FLAG_BACK ? -offset : offset, SEEK_CUR);
+}
+
+/* Write whole bytes from the front of the bit accumulator to file
+    - Success: return 0
+    - Failure: return EOF (Unwritten bytes are kept in the accumulator) */
+int emitBytes(BITFILE* bitfile)
+{
+    return emitOrdered(bitfile, bitfile->_flags & BF_FLAG_MSB);
+}
+
+/* emitBytes for a known bit order (Pending output is never read backward, so top is msb) */
+KERNEL_INLINE int emitOrdered(BITFILE* bitfile, bool msb)
+{
+    byte_t bytes[BITBUF_LEN / BYTE_LEN];
+    size_t count = bitfile->_bitcount / BYTE_LEN;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t shift = i * BYTE_LEN;
+        if (msb) shift = BITBUF_LEN - BYTE_LEN - shift;
+        bytes[i] = (byte_t)(bitfile->_bitbuf >> shift);
+    }
+
+    size_t written = writeBytes(bitfile, bytes, count);
+    takeOrdered(bitfile, written * BYTE_LEN, msb);
+    return written == count ? 0 : EOF;
+}
+
+/* Switch bit accumulator from read-ahead to pending output
+    - Moves file cursor back to the byte under the bit cursor & keeps its leading bits
+    - Success: return 0 */
+int startWrite(BITFILE* bitfile)
+{
+    return startOrdered(bitfile, bitfile->_flags & BF_FLAG_MSB);
+}
+
+/* startWrite for a known bit order */
+KERNEL_INLINE int startOrdered(BITFILE* bitfile, bool msb)
+{
+    if (bitfile->_flags & BF_FLAG_DIRTY) return 0;
+    if (bitfile->_flags & BF_FLAG_BACK || bitfile->_writers != NULL)
+    {
+        errno = EINVAL;
+        return 1;
+    }
+
+    /* Writing past EOF continues from the cursor */
+    if (bfeof(bitfile)) clearbferr(bitfile);
+
+    /* Append mode writes start a new byte at the end of file wherever the cursor was (Like stdio) */
+    if (bitfile->_append)
+    {
+        bitfile->_bitcount = 0;
+        if (seekBytes(bitfile, 0, SEEK_END)) return 1;
+    }
+
+    uint8_t head = (BYTE_LEN - bitfile->_bitcount % BYTE_LEN) % BYTE_LEN;
+    long back = BYTE_SPAN(bitfile->_bitcount);
+
+    bitfile->_bitbuf = 0x0;
+    bitfile->_bitcount = 0;
+    if (seekBytes(bitfile, -back, SEEK_CUR)) return 1;
+
+    if (head)
+    {
+        int byte = readByte(bitfile);
+        if (byte == EOF) return 1;
+        BF_COUNT(bitfile, merges, 1);
+
+        if (msb) putOrdered(bitfile, byte >> (BYTE_LEN - head), head, msb);
+        else     putOrdered(bitfile, byte & LOW_MASK(head), head, msb);
+    }
+
+    bitfile->_flags |= BF_FLAG_DIRTY;
+    return 0;
+}
+
+/* Write pending bits to file, merging the final partial byte with the byte on file
+    - Keeps unwritten bits of the merged byte as read-ahead
+    - Success: return 0 */
+int flushBits(BITFILE* bitfile)
+{
+    return flushOrdered(bitfile, bitfile->_flags & BF_FLAG_MSB);
+}
+
+/* flushBits for a known bit order */
+KERNEL_INLINE int flushOrdered(BITFILE* bitfile, bool msb)
+{
+    if (!(bitfile->_flags & BF_FLAG_DIRTY)) return 0;
+    if (emitOrdered(bitfile, msb)) return EOF;
+
+    uint8_t count = bitfile->_bitcount;
+    byte_t bits = (byte_t)takeOrdered(bitfile, count, msb);
+    bitfile->_flags &= ~(uint8_t)BF_FLAG_DIRTY;
+
+    /* Switch file to reading */
+    if (seekBytes(bitfile, 0, SEEK_CUR)) return EOF;
+    if (!count) return 0;
+
+    int byte = readByte(bitfile);
+    if (byte == EOF) return EOF;
+
+    /* Overlay pending bits onto leading bits of byte */
+    if (msb) byte = (bits << (BYTE_LEN - count)) | (byte & (0xFF >> count));
+    else     byte = bits | (byte & (0xFF << count));
+    byte_t merged = (byte_t)byte;
+    BF_COUNT(bitfile, merges, 1);
+    if (!writeBytes(bitfile, &merged, 1)) return EOF;
+
+    putOrdered(bitfile, merged, BYTE_LEN, msb);
+    takeOrdered(bitfile, count, msb);
+    return seekBytes(bitfile, 0, SEEK_CUR);
+}
+
+/* Set backend with no file or buffer attached */
+void initBackend(BITFILE* bitfile, uint8_t backend)
+{
+    bitfile->_backend = backend;
+    bitfile->_fileobj = NULL;
+    bitfile->_fd = -1;
+    bitfile->_buf = NULL;
+    bitfile->_bufowned = false;
+    bitfile->_shared = false;
+    bitfile->_append = false;
+    bitfile->_bufsize = bitfile->_buflen = bitfile->_bufpos = 0;
+    bitfile->_bufstart = 0;
+    bitfile->_end = INT64_MAX;
+    bitfile->_writers = NULL;
+    bitfile->_async = NULL;
+    bitfile->_trace = NULL;
+    bitfile->_tracearg = NULL;
+    bitfile->_timed = false;
+    clearbfstats(bitfile);
+}
+
+/* Open filename on the given backend (Expects access from copyByteAccessMode)
+    - Success: return 0 */
+int openFile(BITFILE* bitfile, const char* filename, const char* access, uint8_t backend)
+{
+    initBackend(bitfile, backend);
+
+    if (backend == BF_BACKEND_STDIO)
+    {
+        bitfile->_fileobj = fopen(filename, access);
+        return bitfile->_fileobj == NULL;
+    }
+
+    if (backend == BF_BACKEND_MMAP) return mapFile(bitfile, filename);
+
+    int oflags = strchr(access, '+') ? O_RDWR : access[0] == 'r' ? O_RDONLY : O_WRONLY;
+    if (access[0] == 'w') oflags |= O_CREAT | O_TRUNC;
+    if (access[0] == 'a') oflags |= O_CREAT;
+
+    bitfile->_fd = open(filename, oflags, 0666);
+    if (bitfile->_fd < 0) return 1;
+
+    /* Append starts at end of file (Buffer is written with pwrite, which O_APPEND would send to the end again) */
+    bitfile->_append = access[0] == 'a';
+    if (bitfile->_append) bitfile->_bufstart = lseek(bitfile->_fd, 0, SEEK_END);
+
+    if (bitfile->_bufstart >= 0 && !setBuffer(bitfile, NULL, BF_BUFSIZ)) return 0;
+    close(bitfile->_fd);
+    return 1;
+}
+
+/* Map entire file read-only into this._buf (Descriptor is closed once mapped)
+    - Success: return 0 */
+int mapFile(BITFILE* bitfile, const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 1;
+
+    struct stat info;
+    int result = fstat(fd, &info);
+    if (!result && info.st_size)
+    {
+        void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) result = 1;
+        else
+        {
+            bitfile->_buf = map;
+            bitfile->_bufsize = bitfile->_buflen = info.st_size;
+        }
+    }
+
+    close(fd);
+    return result;
+}
+
+/* Close file on its backend, writing out any buffered bytes
+    - Success: return 0 */
+int closeFile(BITFILE* bitfile)
+{
+    if (bitfile->_backend == BF_BACKEND_STDIO) return fclose(bitfile->_fileobj);
+    if (bitfile->_backend == BF_BACKEND_MMAP) return bitfile->_bufsize && !bitfile->_shared ? munmap(bitfile->_buf, bitfile->_bufsize) : 0;
+    if (bitfile->_backend == BF_BACKEND_MEM)
+    {
+        if (bitfile->_bufowned) free(bitfile->_buf);
+        bitfile->_buf = NULL;
+        return 0;
+    }
+
+    int result = stopAsync(bitfile);
+    if (flushBuffer(bitfile)) result = EOF;
+    if (!bitfile->_shared && close(bitfile->_fd)) result = EOF;
+    if (bitfile->_bufowned) free(bitfile->_buf);
+    bitfile->_buf = NULL;
+    return result;
+}
+
+/* Read up to count bytes from the file cursor into dst
+    - Returns number of bytes read (Fewer than count at EOF or on error) */
+size_t readBytes(BITFILE* bitfile, byte_t* dst, size_t count)
+{
+    if (bitfile->_backend == BF_BACKEND_STDIO)
+    {
+        size_t got = fread(dst, 1, count, bitfile->_fileobj);
+        BF_COUNT(bitfile, stdio_calls, 1);
+        BF_COUNT(bitfile, bytes_read, got);
+        return got;
+    }
+
+    /* Memory holds the whole file */
+    if (IN_MEMORY(bitfile))
+    {
+        size_t size = bitfile->_bufpos < bitfile->_buflen ? bitfile->_buflen - bitfile->_bufpos : 0;
+        if (size > count) size = count;
+
+        memcpy(dst, bitfile->_buf + bitfile->_bufpos, size);
+        bitfile->_bufpos += size;
+        BF_COUNT(bitfile, bytes_read, size);
+        return size;
+    }
+
+    size_t total = 0;
+    while (total < count)
+    {
+        if (bitfile->_bufpos == bitfile->_buflen)
+        {
+            if (slideBuffer(bitfile)) break;
+
+            /* Large reads bypass the buffer */
+            ssize_t got;
+            bool direct = count - total >= bitfile->_bufsize;
+            if (direct)
+            {
+                size_t size = clampRead(bitfile, bitfile->_bufstart, count - total);
+                got = syncBehind(bitfile) ? -1 : size ? pread(bitfile->_fd, dst + total, size, bitfile->_bufstart) : 0;
+                BF_COUNT(bitfile, syscalls, size > 0);
+            }
+            else got = loadBuffer(bitfile);
+            if (got <= 0)
+            {
+                if (got < 0) setError(bitfile);
+                break;
+            }
+
+            if (direct)
+            {
+                bitfile->_bufstart += got;
+                total += got;
+                continue;
+            }
+            bitfile->_buflen = got;
+        }
+
+        size_t size = bitfile->_buflen - bitfile->_bufpos;
+        if (size > count - total) size = count - total;
+
+        memcpy(dst + total, bitfile->_buf + bitfile->_bufpos, size);
+        bitfile->_bufpos += size;
+        total += size;
+    }
+    BF_COUNT(bitfile, bytes_read, total);
+    return total;
+}
+
+/* Returns count cut short to end at this._end (0 if offset is past it) */
+size_t clampRead(BITFILE* bitfile, int64_t offset, size_t count)
+{
+    if (offset >= bitfile->_end) return 0;
+    return (uint64_t)(bitfile->_end - offset) < count ? (size_t)(bitfile->_end - offset) : count;
+}
+
+/* Write count bytes from src at the file cursor
+    - Returns number of bytes written (Fewer than count on error) */
+size_t writeBytes(BITFILE* bitfile, const byte_t* src, size_t count)
+{
+    if (bitfile->_backend == BF_BACKEND_STDIO)
+    {
+        size_t put = fwrite(src, 1, count, bitfile->_fileobj);
+        BF_COUNT(bitfile, stdio_calls, 1);
+        BF_COUNT(bitfile, bytes_written, put);
+        return put;
+    }
+
+    if (bitfile->_backend == BF_BACKEND_MEM)
+    {
+        /* Fixed buffer takes what fits */
+        if (bitfile->_bufpos + count > bitfile->_bufsize && growBuffer(bitfile, bitfile->_bufpos + count))
+        {
+            count = bitfile->_bufpos < bitfile->_bufsize ? bitfile->_bufsize - bitfile->_bufpos : 0;
+            setError(bitfile);
+            errno = ENOSPC;
+        }
+        if (!count) return 0;
+
+        /* Zero-fill gap left by seeking past the end */
+        if (bitfile->_bufpos > bitfile->_buflen) memset(bitfile->_buf + bitfile->_buflen, 0, bitfile->_bufpos - bitfile->_buflen);
+
+        memcpy(bitfile->_buf + bitfile->_bufpos, src, count);
+        bitfile->_bufpos += count;
+        if (bitfile->_bufpos > bitfile->_buflen) bitfile->_buflen = bitfile->_bufpos;
+        BF_COUNT(bitfile, bytes_written, count);
+        return count;
+    }
+
+    /* Bytes read ahead may be overwritten */
+    if (bitfile->_async != NULL && !bitfile->_async->write) waitAsync(bitfile->_async);
+
+    size_t total = 0;
+    while (total < count)
+    {
+        if (bitfile->_bufpos == bitfile->_bufsize && slideBuffer(bitfile)) break;
+
+        /* Large writes into an empty buffer bypass it */
+        if (!bitfile->_buflen && count - total >= bitfile->_bufsize)
+        {
+            ssize_t put = syncBehind(bitfile) ? -1 : pwrite(bitfile->_fd, src + total, count - total, bitfile->_bufstart);
+            BF_COUNT(bitfile, syscalls, 1);
+            if (put <= 0)
+            {
+                setError(bitfile);
+                break;
+            }
+            bitfile->_bufstart += put;
+            total += put;
+            continue;
+        }
+
+        size_t size = bitfile->_bufsize - bitfile->_bufpos;
+        if (size > count - total) size = count - total;
+
+        memcpy(bitfile->_buf + bitfile->_bufpos, src + total, size);
+        bitfile->_bufpos += size;
+        if (bitfile->_bufpos > bitfile->_buflen) bitfile->_buflen = bitfile->_bufpos;
+        bitfile->_flags |= BF_FLAG_BUFDIRTY;
+        total += size;
+    }
+    BF_COUNT(bitfile, bytes_written, total);
+    return total;
+}
+
+/* Read up to count bytes at offset into dst without using the file cursor or buffer
+    - Returns number of bytes read (Fewer than count at EOF or on error, which sets errno) */
+size_t preadBytes(BITFILE* bitfile, byte_t* dst, size_t count, int64_t offset)
+{
+    if (IN_MEMORY(bitfile))
+    {
+        size_t size = offset < (int64_t)bitfile->_buflen ? bitfile->_buflen - offset : 0;
+        if (size > count) size = count;
+
+        memcpy(dst, bitfile->_buf + offset, size);
+        COUNT_SHARED(bitfile, bytes_read, size);
+        return size;
+    }
+
+    int fd = bitfile->_backend == BF_BACKEND_STDIO ? fileno(bitfile->_fileobj) : bitfile->_fd;
+    size_t total = 0;
+    while (total < count)
+    {
+        size_t size = clampRead(bitfile, offset + total, count - total);
+        ssize_t got = size ? pread(fd, dst + total, size, offset + total) : 0;
+        COUNT_SHARED(bitfile, syscalls, size > 0);
+        if (got <= 0) break;
+        total += got;
+    }
+    COUNT_SHARED(bitfile, bytes_read, total);
+    return total;
+}
+
+/* Write count bytes from src at offset without using the file cursor or buffer
+    - Memory backend writes only over bytes it already holds (Never grows or moves memory)
+    - Descriptor buffer's copy of the bytes is patched, so flushing it can't undo the write
+    - Returns number of bytes written (Fewer than count on error, which sets errno) */
+size_t pwriteBytes(BITFILE* bitfile, const byte_t* src, size_t count, int64_t offset)
+{
+    if (bitfile->_backend == BF_BACKEND_MEM)
+    {
+        size_t size = offset < (int64_t)bitfile->_buflen ? bitfile->_buflen - offset : 0;
+        if (size < count) errno = ENOSPC;
+        else size = count;
+
+        memcpy(bitfile->_buf + offset, src, size);
+        COUNT_SHARED(bitfile, bytes_written, size);
+        return size;
+    }
+
+    int fd = bitfile->_backend == BF_BACKEND_STDIO ? fileno(bitfile->_fileobj) : bitfile->_fd;
+    size_t total = 0;
+    while (total < count)
+    {
+        ssize_t put = pwrite(fd, src + total, count - total, offset + total);
+        COUNT_SHARED(bitfile, syscalls, 1);
+        if (put <= 0) break;
+        total += put;
+    }
+    COUNT_SHARED(bitfile, bytes_written, total);
+
+    if (bitfile->_backend == BF_BACKEND_FD)
+    {
+        int64_t start = offset > bitfile->_bufstart ? offset : bitfile->_bufstart;
+        int64_t end = bitfile->_bufstart + (int64_t)bitfile->_buflen;
+        if (end > offset + (int64_t)total) end = offset + total;
+        if (start < end) memcpy(bitfile->_buf + (start - bitfile->_bufstart), src + (start - offset), end - start);
+    }
+    return total;
+}
+
+/* Write number_of_bits from input starting bit_offset bits into the file (For bfpwrite)
+    - Returns number of bits written */
+bsize_t pwriteBits(BITFILE* bitfile, const byte_t* input, bsize_t number_of_bits, bpos_t bit_offset)
+{
+    size_t whole = number_of_bits / BYTE_LEN;
+    uint8_t partial = number_of_bits % BYTE_LEN;
+    int64_t start = bit_offset / BYTE_LEN;
+    uint8_t shift = bit_offset % BYTE_LEN;
+    bool msb = bitfile->_flags & BF_FLAG_MSB;
+
+    /* Byte-aligned: whole bytes go straight from input */
+    if (!shift)
+    {
+        size_t count = pwriteBytes(bitfile, input, whole, start);
+        if (count < whole) return (bsize_t)count * BYTE_LEN;
+        if (partial)
+        {
+            byte_t bits = msb ? input[whole] << (BYTE_LEN - partial) : input[whole] & (0xFF >> (BYTE_LEN - partial));
+            byte_t keep = msb ? 0xFF >> partial : 0xFF << partial;
+            if (mergeByte(bitfile, bits, keep, start + whole)) return (bsize_t)whole * BYTE_LEN;
+        }
+        return number_of_bits;
+    }
+
+    /* Shift input into chunks of file bytes, merging bits that aren't overwritten at either end */
+    byte_t chunk[BF_PACK_CHUNK];
+    size_t span = BYTE_SPAN(shift + number_of_bits);
+    uint8_t tail = (shift + number_of_bits) % BYTE_LEN;
+    byte_t prev = 0;
+    for (size_t done = 0; done < span;)
+    {
+        size_t size = span - done < BF_PACK_CHUNK ? span - done : BF_PACK_CHUNK;
+        for (size_t i = 0; i < size; i++)
+        {
+            /* Input bytes are taken in stream order (Partial byte moved to where the stream continues) */
+            size_t b = done + i;
+            byte_t curr = b < whole ? input[b] : b == whole && partial ? (msb ? input[b] << (BYTE_LEN - partial) : input[b] & (0xFF >> (BYTE_LEN - partial))) : 0;
+            if (msb) chunk[i] = (byte_t)((prev << (BYTE_LEN - shift)) | (curr >> shift));
+            else     chunk[i] = (byte_t)((prev >> (BYTE_LEN - shift)) | (curr << shift));
+            prev = curr;
+        }
+
+        /* End bytes keep the file's bits outside the write, bytes between them are written as is */
+        bool last = done + size == span && tail;
+        size_t lo = 0, hi = size - (last && span > 1);
+        if (!done)
+        {
+            byte_t keep = msb ? 0xFF << (BYTE_LEN - shift) : 0xFF >> (BYTE_LEN - shift);
+            if (span == 1 && tail) keep |= msb ? 0xFF >> tail : 0xFF << tail;
+            if (mergeByte(bitfile, chunk[0] & ~keep, keep, start)) return 0;
+            lo = 1;
+        }
+
+        size_t count = lo < hi ? pwriteBytes(bitfile, chunk + lo, hi - lo, start + done + lo) : 0;
+        if (lo + count < hi) return (bsize_t)(done + lo + count) * BYTE_LEN - shift;
+
+        if (hi < size)
+        {
+            byte_t keep = msb ? 0xFF >> tail : 0xFF << tail;
+            if (mergeByte(bitfile, chunk[hi] & ~keep, keep, start + done + hi)) return (bsize_t)(done + hi) * BYTE_LEN - shift;
+        }
+        done += size;
+    }
+    return number_of_bits;
+}
+
+/* Write bits over the byte at offset, keeping the bits set in keep (Bytes past EOF start as 0)
+    - Shared bitfiles merge each byte one writer at a time
+    - Success: return 0 */
+int mergeByte(BITFILE* bitfile, byte_t bits, byte_t keep, int64_t offset)
+{
+    bfwriters_t* writers = bitfile->_writers;
+    byte_t byte = 0;
+    COUNT_SHARED(bitfile, merges, 1);
+
+    /* Shared memory is merged in place atomically */
+    if (writers != NULL && bitfile->_backend == BF_BACKEND_MEM)
+    {
+        if (offset >= (int64_t)bitfile->_buflen)
+        {
+            errno = ENOSPC;
+            return EOF;
+        }
+        byte_t* target = bitfile->_buf + offset;
+        byte = __atomic_load_n(target, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(target, &byte, (byte & keep) | bits, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        return 0;
+    }
+
+    bool* lock = writers != NULL ? &writers->locks[offset % BF_SHARE_LOCKS] : NULL;
+    if (lock != NULL) while (__atomic_test_and_set(lock, __ATOMIC_ACQUIRE));
+
+    /* Descriptor buffer holds the newest copy of the bytes in its window */
+    int64_t buffered = offset - bitfile->_bufstart;
+    if (bitfile->_backend == BF_BACKEND_FD && buffered >= 0 && buffered < (int64_t)bitfile->_buflen) byte = bitfile->_buf[buffered];
+    else preadBytes(bitfile, &byte, 1, offset);
+    byte = (byte & keep) | bits;
+    int result = pwriteBytes(bitfile, &byte, 1, offset) != 1;
+
+    if (lock != NULL) __atomic_clear(lock, __ATOMIC_RELEASE);
+    return result;
+}
+
+/* Move file cursor to offset bytes from whence
+    - Seeks within the descriptor buffer without a syscall
+    - Success: return 0 */
+int seekBytes(BITFILE* bitfile, int64_t offset, int whence)
+{
+    if (bitfile->_backend == BF_BACKEND_STDIO)
+    {
+        BF_COUNT(bitfile, stdio_calls, 1);
+        BF_COUNT(bitfile, file_seeks, 1);
+        return fseek(bitfile->_fileobj, (long)offset, whence);
+    }
+
+    if (whence == SEEK_CUR) offset += bitfile->_bufstart + bitfile->_bufpos;
+    else if (whence == SEEK_END && IN_MEMORY(bitfile)) offset += bitfile->_buflen;
+    else if (whence == SEEK_END)
+    {
+        int64_t size = syncBehind(bitfile) ? -1 : lseek(bitfile->_fd, 0, SEEK_END);
+        BF_COUNT(bitfile, syscalls, 1);
+        if (size < 0) return -1;
+        if (size > bitfile->_end) size = bitfile->_end;
+
+        /* Include buffered bytes past the end of file */
+        if (size < bitfile->_bufstart + (int64_t)bitfile->_buflen) size = bitfile->_bufstart + bitfile->_buflen;
+        offset += size;
+    }
+
+    if (offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Seeking memory is pointer arithmetic (Reads past the end return EOF) */
+    if (IN_MEMORY(bitfile))
+    {
+        bitfile->_bufpos = offset;
+        BF_COUNT(bitfile, buffer_seeks, 1);
+        return 0;
+    }
+
+    if (offset >= bitfile->_bufstart && offset <= bitfile->_bufstart + (int64_t)bitfile->_buflen)
+    {
+        bitfile->_bufpos = offset - bitfile->_bufstart;
+        BF_COUNT(bitfile, buffer_seeks, 1);
+        return 0;
+    }
+
+    if (slideBuffer(bitfile)) return -1;
+    bitfile->_bufstart = offset;
+    BF_COUNT(bitfile, file_seeks, 1);
+    return 0;
+}
+
+/* Returns byte offset of file cursor (Descriptor backend makes no syscall) */
+int64_t tellBytes(BITFILE* bitfile)
+{
+    if (bitfile->_backend == BF_BACKEND_STDIO)
+    {
+        BF_COUNT(bitfile, stdio_calls, 1);
+        return ftell(bitfile->_fileobj);
+    }
+    return bitfile->_bufstart + bitfile->_bufpos;
+}
+
+/* Write buffered bytes to file
+    - Success: return 0 */
+int flushBuffer(BITFILE* bitfile)
+{
+    if (bitfile->_backend == BF_BACKEND_STDIO)
+    {
+        BF_COUNT(bitfile, stdio_calls, 1);
+        return fflush(bitfile->_fileobj);
+    }
+    if (syncBehind(bitfile)) return EOF;
+    if (!(bitfile->_flags & BF_FLAG_BUFDIRTY)) return 0;
+
+    size_t total = 0;
+    while (total < bitfile->_buflen)
+    {
+        ssize_t put = pwrite(bitfile->_fd, bitfile->_buf + total, bitfile->_buflen - total, bitfile->_bufstart + total);
+        BF_COUNT(bitfile, syscalls, 1);
+        if (put <= 0)
+        {
+            setError(bitfile);
+            return EOF;
+        }
+        total += put;
+    }
+
+    bitfile->_flags &= ~(uint8_t)BF_FLAG_BUFDIRTY;
+    return 0;
+}
+
+/* Fill empty descriptor buffer with the bytes at this._bufstart (Swaps in the read-ahead buffer if it holds them)
+    - Returns number of bytes read (0 at EOF, -1 on error) */
+ssize_t loadBuffer(BITFILE* bitfile)
+{
+    bfasync_t* ahead = bitfile->_async != NULL && !bitfile->_async->write ? bitfile->_async : NULL;
+    ssize_t got = -1;
+    if (syncBehind(bitfile)) return -1;
+    BF_COUNT(bitfile, refills, 1);
+
+    /* Bytes read ahead for another offset are dropped */
+    if (ahead != NULL && (ahead->start != bitfile->_bufstart || (got = waitAsync(ahead)) < 0)) waitAsync(ahead);
+
+    if (got >= 0)
+    {
+        byte_t* buf = bitfile->_buf;
+        bitfile->_buf = ahead->buf;
+        ahead->buf = buf;
+    }
+    else
+    {
+        size_t size = clampRead(bitfile, bitfile->_bufstart, bitfile->_bufsize);
+        got = size ? pread(bitfile->_fd, bitfile->_buf, size, bitfile->_bufstart) : 0;
+        BF_COUNT(bitfile, syscalls, size > 0);
+    }
+
+    /* Start reading the next window while this one is used */
+    if (ahead != NULL && got > 0) requestAhead(bitfile, bitfile->_bufstart + got);
+    return got;
+}
+
+/* Start reading ahead of (Or writing behind) the cursor with a second buffer (Not supported without POSIX asynchronous I/O)
+    - Success: return 0 */
+int startAsync(BITFILE* bitfile, bool write)
+{
+#ifdef _POSIX_ASYNCHRONOUS_IO
+    if (bitfile->_async != NULL && bitfile->_async->write == write) return 0;
+    if (stopAsync(bitfile)) return -1;
+
+    bfasync_t* async = calloc(1, sizeof(bfasync_t));
+    if (async == NULL) return -1;
+    if (posix_memalign((void**)&async->buf, BF_BUFALIGN, bitfile->_bufsize))
+    {
+        free(async);
+        return -1;
+    }
+    async->home = bitfile->_buf;
+    async->start = -1;
+    async->write = write;
+    bitfile->_async = async;
+
+    /* First read covers the window after the buffered bytes */
+    if (!write) requestAhead(bitfile, bitfile->_bufstart + bitfile->_buflen);
+#endif
+    return 0;
+}
+
+/* Stop background I/O, moving buffered bytes back into the bitfile's own buffer
+    - Success: return 0 (Failure: a buffer written behind didn't reach the file) */
+int stopAsync(BITFILE* bitfile)
+{
+    bfasync_t* async = bitfile->_async;
+    if (async == NULL) return 0;
+
+    int result = syncBehind(bitfile);
+    waitAsync(async);
+    if (bitfile->_buf != async->home)
+    {
+        memcpy(async->home, bitfile->_buf, bitfile->_buflen);
+        async->buf = bitfile->_buf;
+        bitfile->_buf = async->home;
+    }
+    free(async->buf);
+    free(async);
+    bitfile->_async = NULL;
+    return result;
+}
+
+/* Request the window at offset be read into the read-ahead buffer (Nothing is requested past EOF or the end of range) */
+void requestAhead(BITFILE* bitfile, int64_t offset)
+{
+    bfasync_t* async = bitfile->_async;
+    async->start = -1;
+
+#ifdef _POSIX_ASYNCHRONOUS_IO
+    async->size = clampRead(bitfile, offset, bitfile->_bufsize);
+    if (!async->size) return;
+
+    memset(&async->request, 0, sizeof(async->request));
+    async->request.aio_fildes = bitfile->_fd;
+    async->request.aio_buf = async->buf;
+    async->request.aio_nbytes = async->size;
+    async->request.aio_offset = offset;
+    async->request.aio_sigevent.sigev_notify = SIGEV_NONE;
+    BF_COUNT(bitfile, syscalls, 1);
+    if (!aio_read(&async->request)) async->start = offset;
+#endif
+}
+
+/* Hand the dirty descriptor buffer to a background write & continue in the other buffer
+    - Success: return 0 */
+int writeBehind(BITFILE* bitfile)
+{
+    if (syncBehind(bitfile)) return EOF;
+
+#ifdef _POSIX_ASYNCHRONOUS_IO
+    bfasync_t* async = bitfile->_async;
+    memset(&async->request, 0, sizeof(async->request));
+    async->request.aio_fildes = bitfile->_fd;
+    async->request.aio_buf = bitfile->_buf;
+    async->request.aio_nbytes = bitfile->_buflen;
+    async->request.aio_offset = bitfile->_bufstart;
+    async->request.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+    /* Write now if the request can't be queued */
+    BF_COUNT(bitfile, syscalls, 1);
+    if (aio_write(&async->request)) return flushBuffer(bitfile);
+
+    async->start = bitfile->_bufstart;
+    async->size = bitfile->_buflen;
+    byte_t* buf = bitfile->_buf;
+    bitfile->_buf = async->buf;
+    async->buf = buf;
+    bitfile->_flags &= ~(uint8_t)BF_FLAG_BUFDIRTY;
+    return 0;
+#else
+    return flushBuffer(bitfile);
+#endif
+}
+
+/* Wait for a buffer written behind the cursor to reach the file (Before the file is used any other way)
+    - Success: return 0 (Failure sets the error flag) */
+int syncBehind(BITFILE* bitfile)
+{
+    bfasync_t* async = bitfile->_async;
+    if (async == NULL || !async->write || async->start < 0) return 0;
+
+    if (waitAsync(async) == (ssize_t)async->size) return 0;
+    setError(bitfile);
+    return EOF;
+}
+
+/* Wait for the pending background request to finish (Its bytes are no longer pending after this)
+    - Returns number of bytes read or written, -1 if none were pending or on error */
+ssize_t waitAsync(bfasync_t* async)
+{
+    if (async->start < 0) return -1;
+    async->start = -1;
+
+#ifdef _POSIX_ASYNCHRONOUS_IO
+    const struct aiocb* list[] = { &async->request };
+    while (aio_error(&async->request) == EINPROGRESS) aio_suspend(list, 1, NULL);
+    return aio_return(&async->request);
+#else
+    return -1;
+#endif
+}
+
+/* Write out descriptor buffer & restart it empty at the file cursor
+    - Success: return 0 */
+int slideBuffer(BITFILE* bitfile)
+{
+    /* Full buffers are written behind the cursor when advised */
+    bool behind = bitfile->_async != NULL && bitfile->_async->write && (bitfile->_flags & BF_FLAG_BUFDIRTY);
+    if (behind ? writeBehind(bitfile) : flushBuffer(bitfile)) return EOF;
+
+    bitfile->_bufstart += bitfile->_bufpos;
+    bitfile->_bufpos = bitfile->_buflen = 0;
+    return 0;
+}
+
+/* Reload descriptor buffer with the bytes ending at the file cursor (For reading backward)
+    - Success: return 0
+    - Failure: return EOF (Buffer is left empty at the cursor) */
+int slideBufferBack(BITFILE* bitfile)
+{
+    int64_t end = tellBytes(bitfile);
+    if (slideBuffer(bitfile) || syncBehind(bitfile)) return EOF;
+
+    int64_t start = end > (int64_t)bitfile->_bufsize ? end - (int64_t)bitfile->_bufsize : 0;
+    ssize_t got = end <= bitfile->_end ? pread(bitfile->_fd, bitfile->_buf, end - start, start) : 0;
+    BF_COUNT(bitfile, refills, 1);
+    BF_COUNT(bitfile, syscalls, end <= bitfile->_end);
+    if (got != end - start)
+    {
+        if (got < 0) setError(bitfile);
+        return EOF;
+    }
+
+    bitfile->_bufstart = start;
+    bitfile->_bufpos = bitfile->_buflen = got;
+    return 0;
+}
+
+/* Replace descriptor buffer with buffer of size (NULL allocates an aligned buffer)
+    - Expects buffered bytes to already be written
+    - Success: return 0 */
+int setBuffer(BITFILE* bitfile, byte_t* buffer, size_t size)
+{
+    if (!size)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    bool owned = buffer == NULL;
+    if (owned && posix_memalign((void**)&buffer, BF_BUFALIGN, size)) return -1;
+
+    if (bitfile->_bufowned) free(bitfile->_buf);
+    bitfile->_bufstart += bitfile->_bufpos;
+    bitfile->_bufpos = bitfile->_buflen = 0;
+    bitfile->_buf = buffer;
+    bitfile->_bufsize = size;
+    bitfile->_bufowned = owned;
+    return 0;
+}
+
+/* Grow heap buffer of memory backend to hold at least size bytes
+    - Success: return 0 (Fails for caller-owned memory) */
+int growBuffer(BITFILE* bitfile, size_t size)
+{
+    if (!bitfile->_bufowned) return -1;
+
+    size_t capacity = bitfile->_bufsize * 2;
+    if (capacity < size) capacity = size;
+
+    byte_t* buffer = realloc(bitfile->_buf, capacity);
+    if (buffer == NULL) return -1;
+
+    bitfile->_buf = buffer;
+    bitfile->_bufsize = capacity;
+    return 0;
+}
+
+/* Attempt disallowed read/write to set error indicator & errno (EBADF) */
+void badAccess(BITFILE* bitfile, void* ptr, bool write)
+{
+    if (bitfile->_backend == BF_BACKEND_STDIO)
+    {
+        if (write) fwrite(ptr, 1, 1, bitfile->_fileobj);
+        else fread(ptr, 1, 1, bitfile->_fileobj);
+        return;
+    }
+    errno = EBADF;
+    setError(bitfile);
+}
+
+/* Store access mode w/ appended 'b' in byte_access & backend selected by trailing letters
+    - Expects: r,w,a,r+,w+,a+,rb,wb,ab,rb+,wb+,ab+,r+b,w+b,a+b
+    - Optional: 'd' for descriptor backend, 'm' for mapped backend (Otherwise stdio)
+    - Success: return appropriate read/write flags
+    - Invalid string: return 1 */
+uint8_t copyByteAccessMode(const char* basic_access, char* byte_access, uint8_t* backend)
+{
+    int len = strlen(basic_access);
+    if (len < 1 || len > VALID_ACCESS_CHARS_OUTER_SZ)
+    {
+        errno = EINVAL;
+        return BF_FLAG_ERR;
+    }
+
+    uint8_t flags = 0;
+    bool has_b = false;
+    int size = 0;
+    *backend = BF_BACKEND_STDIO;
+    for (int i = 0; i < len; i++)
+    {
+        if (!isIn(basic_access[i], valid_access_chars[i], VALID_ACCESS_CHARS_INNER_SZ))
+        {
+            errno = EINVAL;
+            return BF_FLAG_ERR | flags;
         }
 
         switch (basic_access[i])
         {
             case '+':
                 flags |= BF_FLAG_WRITE;
+                /* fall through */
             case 'r':
                 flags |= BF_FLAG_READ;
                 break;
@@ -452,12 +2825,722 @@ uint8_t copyByteAccessMode(const char* basic_access, char* byte_access)
             case 'b':
                 has_b = true;
                 break;
+
+            case 'd':
+                *backend = BF_BACKEND_FD;
+                continue; /* Not passed to fopen */
+
+            case 'm':
+                *backend = BF_BACKEND_MMAP;
+                continue;
         }
 
-        byte_access[i] = basic_access[i];
+        byte_access[size++] = basic_access[i];
+    }
+
+    /* Leave room for 'b' & NUL, mapping is read-only */
+    if (size + !has_b >= ACCESS_MODE_LEN || (*backend == BF_BACKEND_MMAP && flags != BF_FLAG_READ))
+    {
+        errno = EINVAL;
+        return BF_FLAG_ERR | flags;
     }
 
-    if (!has_b) byte_access[len++] = 'b';
-    byte_access[len] = '\0';
+    if (!has_b) byte_access[size++] = 'b';
+    byte_access[size] = '\0';
     return flags;
 }
+
+
+/* Count & consume 0 bits up to & including the next 1 bit
+    - Counts leading (MSB) or trailing (LSB) zeros of the accumulator a word at a time
+    - EOF: returns zeros read & sets EOF */
+uint64_t takeZeros(BITFILE* bitfile)
+{
+    uint64_t zeros = 0;
+    while (true)
+    {
+        if (!bitfile->_bitcount && !fillBits(bitfile))
+        {
+            markEOF(bitfile);
+            BF_COUNT(bitfile, bits_read, zeros);
+            return zeros;
+        }
+
+        /* Bits past _bitcount are always 0 */
+        uint8_t run = BITBUF_LEN;
+        if (bitfile->_bitbuf) run = BF_TOP_FIRST(bitfile->_flags) ? __builtin_clzll(bitfile->_bitbuf) : __builtin_ctzll(bitfile->_bitbuf);
+
+        if (run < bitfile->_bitcount)
+        {
+            takeBits(bitfile, run + 1);
+            BF_COUNT(bitfile, bits_read, zeros + run + 1);
+            return zeros + run;
+        }
+        zeros += bitfile->_bitcount;
+        takeBits(bitfile, bitfile->_bitcount);
+    }
+}
+
+/* Read a code's zero run & 1 bit
+    - Returns length of zero run (Check bfeof for EOF) */
+uint64_t getCode(BITFILE* bitfile)
+{
+    if (!(bitfile->_flags & BF_FLAG_READ))
+    {
+        uint64_t bits;
+        badAccess(bitfile, &bits, false);
+        return 0;
+    }
+    if (flushBits(bitfile) || bfeof(bitfile)) return 0;
+
+    return takeZeros(bitfile);
+}
+
+/* Write a code: zeros 0 bits, a 1 bit, then the lowest width bits of info
+    - Returns number of bits written (0 on failure) */
+bsize_t putCode(BITFILE* bitfile, uint64_t zeros, uint64_t info, unsigned width)
+{
+    bsize_t count = zeros + 1 + width;
+
+    /* Whole code fits one field */
+    if (count <= BITBUF_LEN)
+    {
+        uint64_t field;
+        info = width ? info & LOW_MASK(width) : 0x0;
+        if (bitfile->_flags & BF_FLAG_MSB) field = info | (UINT64_C(1) << width);
+        else                               field = ((info << 1) | 1) << zeros;
+        return bfputbits(bitfile, field, count) == (int)count ? count : 0;
+    }
+
+    for (; zeros >= BITBUF_LEN; zeros -= BITBUF_LEN)
+    {
+        if (bfputbits(bitfile, 0x0, BITBUF_LEN) != BITBUF_LEN) return 0;
+    }
+    if (bfputbits(bitfile, bitfile->_flags & BF_FLAG_MSB ? 0x1 : UINT64_C(1) << zeros, zeros + 1) != (int)zeros + 1) return 0;
+    if (width && bfputbits(bitfile, info, width) != (int)width) return 0;
+    return count;
+}
+
+/* Look up the code at the cursor without consuming it
+    - Peeks the longest code length, then indexes the root table & any linked sub-tables
+    - Returns NULL at EOF (Or if the code runs past it) or if no code matches (errno = EILSEQ) */
+const bfhuffentry_t* lookupSym(BITFILE* bitfile, const bfhuff_t* table)
+{
+    uint64_t bits = bfpeekbits(bitfile, table->_maxlen);
+    if (bfeof(bitfile)) return NULL;
+
+    /* Follow sub-table links until a symbol entry */
+    const bfhuffentry_t* entry;
+    uint8_t depth = table->_rootbits;
+    if (table->_msb)
+    {
+        entry = table->_table + (bits >> (table->_maxlen - depth));
+        while (entry->sub)
+        {
+            depth += entry->sub;
+            entry = table->_table + entry->value + ((bits >> (table->_maxlen - depth)) & LOW_MASK(entry->sub));
+        }
+    }
+    else
+    {
+        entry = table->_table + (bits & LOW_MASK(depth));
+        while (entry->sub)
+        {
+            uint8_t sub = entry->sub;
+            entry = table->_table + entry->value + ((bits >> depth) & LOW_MASK(sub));
+            depth += sub;
+        }
+    }
+
+    if (!entry->length)
+    {
+        errno = EILSEQ;
+        return NULL;
+    }
+
+    /* Peeking filled the accumulator unless the file ends first, so it holds every bit left */
+    if (entry->length > bitfile->_bitcount)
+    {
+        markEOF(bitfile);
+        return NULL;
+    }
+    return entry;
+}
+
+/* Check bitfile can be decoded with table
+    - Success: return 0
+    - Failure: return EOF */
+int checkSymOrder(BITFILE* bitfile, const bfhuff_t* table)
+{
+    if (!(bitfile->_flags & BF_FLAG_READ))
+    {
+        uint64_t bits;
+        badAccess(bitfile, &bits, false);
+        return EOF;
+    }
+    if (!BF_TOP_FIRST(bitfile->_flags) != !table->_msb)
+    {
+        errno = EINVAL;
+        return EOF;
+    }
+    return 0;
+}
+
+/* Reverse the order of the lowest count bits */
+uint32_t reverseBits(uint32_t bits, uint8_t count)
+{
+    /* Swap halves, then bytes, nibbles, pairs & single bits (x86 has no bit reverse instruction to dispatch to) */
+    bits = (bits >> 16) | (bits << 16);
+    bits = ((bits >> 8) & 0x00FF00FF) | ((bits & 0x00FF00FF) << 8);
+    bits = ((bits >> 4) & 0x0F0F0F0F) | ((bits & 0x0F0F0F0F) << 4);
+    bits = ((bits >> 2) & 0x33333333) | ((bits & 0x33333333) << 2);
+    bits = ((bits >> 1) & 0x55555555) | ((bits & 0x55555555) << 1);
+    return count ? bits >> (32 - count) : 0;
+}
+
+/* Shift the top byte of the encoder interval out to the bitfile
+    - Bytes are held back while they could still be changed by a carry (A 0xFF run)
+    - Success: return 0
+    - Failure: return EOF */
+int shiftLow(bfrange_t* coder)
+{
+    if ((uint32_t)coder->_low < 0xFF000000 || coder->_low >> 32)
+    {
+        byte_t carry = coder->_low >> 32;
+        byte_t byte = coder->_cache;
+        for (; coder->_cachesize; coder->_cachesize--, byte = 0xFF)
+        {
+            if (bfputbits(coder->_bitfile, (byte_t)(byte + carry), BYTE_LEN) != BYTE_LEN) return EOF;
+        }
+        coder->_cache = coder->_low >> 24;
+    }
+    coder->_cachesize++;
+    coder->_low = (coder->_low & 0x00FFFFFF) << BYTE_LEN;
+    return 0;
+}
+
+/* Shift the next coded byte from the bitfile into the decoder
+    - Success: return 0
+    - Failure: return EOF (Coded stream ended) */
+int shiftCode(bfrange_t* coder)
+{
+    uint64_t byte = bfgetbits(coder->_bitfile, BYTE_LEN);
+    if (bfeof(coder->_bitfile)) return EOF;
+    coder->_code = (coder->_code << BYTE_LEN) | byte;
+    return 0;
+}
+
+/* Extensions usable by bit kernels on the running CPU (BF_KERNEL_*) */
+int cpuKernels(void)
+{
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+    int kernels = BF_KERNEL_SSE2;
+    if (__builtin_cpu_supports("sse4.1")) kernels |= BF_KERNEL_SSE41;
+    if (__builtin_cpu_supports("avx2")) kernels |= BF_KERNEL_AVX2;
+    if (__builtin_cpu_supports("bmi2")) kernels |= BF_KERNEL_BMI2;
+    return kernels;
+#else
+    return 0;
+#endif
+}
+
+/* Extensions bit kernels use now (Picks all the running CPU supports on first call) */
+int activeKernels(void)
+{
+    int kernels = __atomic_load_n(&kernelSet, __ATOMIC_RELAXED);
+    if (kernels >= 0) return kernels;
+
+    /* Keep a set chosen by bfkernels in the meantime */
+    int unset = -1;
+    kernels = cpuKernels();
+    if (!__atomic_compare_exchange_n(&kernelSet, &unset, kernels, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) kernels = unset;
+    return kernels;
+}
+
+/* Read count width-bit values into dst32 or dst64
+    - Re-reads the bytes held in the accumulator, then unpacks a chunk of bytes at a time
+    - Returns number of values read (Fewer at EOF) */
+size_t readPacked(BITFILE* bitfile, uint32_t* dst32, uint64_t* dst64, size_t count, unsigned width)
+{
+    if (!(bitfile->_flags & BF_FLAG_READ))
+    {
+        badAccess(bitfile, dst32 ? (void*)dst32 : (void*)dst64, false);
+        return 0;
+    }
+    if (bitfile->_flags & BF_FLAG_BACK)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    if (!count || flushBits(bitfile) || bfeof(bitfile)) return 0;
+
+    size_t done = 0;
+
+    /* Short runs come straight from the accumulator */
+    if ((uint64_t)count * width < PACK_MIN)
+    {
+        for (; done < count; done++)
+        {
+            uint64_t value = bfgetbits(bitfile, width);
+            if (bfeof(bitfile)) break;
+            if (dst32) dst32[done] = (uint32_t)value;
+            else       dst64[done] = value;
+        }
+        return done;
+    }
+
+    /* Back file cursor up to the first byte held in the accumulator */
+    uint8_t offset = (BYTE_LEN - bitfile->_bitcount % BYTE_LEN) % BYTE_LEN;
+    if (seekBytes(bitfile, -(int64_t)BYTE_SPAN(bitfile->_bitcount), SEEK_CUR)) return 0;
+    bitfile->_bitbuf = 0x0;
+    bitfile->_bitcount = 0;
+
+    byte_t chunk[BF_PACK_CHUNK + PACK_PAD];
+    bool msb = bitfile->_flags & BF_FLAG_MSB;
+    while (done < count)
+    {
+        size_t size = BF_PACK_CHUNK;
+        uint64_t bits = (uint64_t)(count - done) * width + offset;
+        if (bits < (uint64_t)BF_PACK_CHUNK * BYTE_LEN) size = BYTE_SPAN(bits);
+
+        size_t got = readBytes(bitfile, chunk, size);
+        memset(chunk + got, 0, PACK_PAD);
+
+        size_t values = got * BYTE_LEN > offset ? (got * BYTE_LEN - offset) / width : 0;
+        if (values > count - done) values = count - done;
+        if (dst32) unpackBits(chunk, offset, values, width, msb, dst32 + done);
+        else     unpackBits64(chunk, offset, values, width, msb, dst64 + done);
+        done += values;
+        BF_COUNT(bitfile, bits_read, (uint64_t)values * width);
+
+        if (got < size)
+        {
+            markEOF(bitfile);
+            return done;
+        }
+
+        /* Step back over bytes holding the next value */
+        uint64_t used = offset + (uint64_t)values * width;
+        offset = used % BYTE_LEN;
+        if (got > used / BYTE_LEN && seekBytes(bitfile, (int64_t)(used / BYTE_LEN) - (int64_t)got, SEEK_CUR)) return done;
+    }
+
+    /* Resume the accumulator after the last value */
+    fillBits(bitfile);
+    takeBits(bitfile, offset);
+    return done;
+}
+
+/* Unpack count width-bit (1-32) values starting offset bits into src
+    - src must have PACK_PAD readable bytes past the last value */
+void unpackBits(const byte_t* src, uint8_t offset, size_t count, unsigned width, bool msb, uint32_t* dst)
+{
+    size_t i = unpackVector(src, offset, count, width, msb, dst);
+#ifdef X86_KERNELS
+    if (activeKernels() & BF_KERNEL_BMI2) i = unpackBMI2(src, offset, i, count, width, msb, dst);
+#endif
+    unpackScalar(src, offset, i, count, width, msb, dst);
+}
+
+/* Unpack values i up to count with one word load each
+    - Returns count */
+size_t unpackScalar(const byte_t* src, uint8_t offset, size_t i, size_t count, unsigned width, bool msb, uint32_t* dst)
+{
+    for (; i < count; i++)
+    {
+        uint64_t bit = offset + (uint64_t)i * width;
+        uint64_t word = loadWord(src + bit / BYTE_LEN, msb);
+        uint8_t shift = bit % BYTE_LEN;
+
+        /* Value ends within the word, so one shift & mask takes it from either end */
+        dst[i] = (uint32_t)((word >> (msb ? BITBUF_LEN - width - shift : shift)) & LOW_MASK(width));
+    }
+    return count;
+}
+
+/* Unpack count width-bit (1-64) values starting offset bits into src
+    - src must have PACK_PAD readable bytes past the last value */
+void unpackBits64(const byte_t* src, uint8_t offset, size_t count, unsigned width, bool msb, uint64_t* dst)
+{
+    /* Narrow values go through the 32-bit kernels a block at a time */
+    if (width <= 32)
+    {
+        uint32_t block[256];
+        for (size_t i = 0; i < count; i += 256)
+        {
+            size_t size = count - i < 256 ? count - i : 256;
+            uint64_t bit = offset + (uint64_t)i * width;
+            unpackBits(src + bit / BYTE_LEN, bit % BYTE_LEN, size, width, msb, block);
+            for (size_t j = 0; j < size; j++) dst[i + j] = block[j];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t bit = offset + (uint64_t)i * width;
+        const byte_t* ptr = src + bit / BYTE_LEN;
+        uint64_t word = loadWord(ptr, msb);
+        uint8_t shift = bit % BYTE_LEN;
+
+        /* Value may spill into a ninth byte */
+        if (msb)
+        {
+            word <<= shift;
+            if (shift) word |= ptr[BYTE_LEN] >> (BYTE_LEN - shift);
+            dst[i] = word >> (BITBUF_LEN - width);
+        }
+        else
+        {
+            word >>= shift;
+            if (shift) word |= (uint64_t)ptr[BYTE_LEN] << (BITBUF_LEN - shift);
+            dst[i] = width == BITBUF_LEN ? word : word & LOW_MASK(width);
+        }
+    }
+}
+
+/* Unpack as many groups of 8 values as possible using vector shuffle & shift
+    - Returns number of values unpacked (0 without SSE4.1/AVX2 or for wide values) */
+size_t unpackVector(const byte_t* src, uint8_t offset, size_t count, unsigned width, bool msb, uint32_t* dst)
+{
+#ifdef X86_KERNELS
+    if (width > PACK_VECTOR_MAX) return 0;
+
+    /* 8 values span exactly width bytes, so one shuffle & shift pattern fits every group
+        - Each half of the group is 4 values loaded from its own 16 bytes */
+    int8_t shuffle[32];
+    int32_t shift[8];
+    size_t base[2];
+    for (int half = 0; half < 2; half++)
+    {
+        base[half] = (offset + 4 * half * width) / BYTE_LEN;
+        for (int j = 0; j < 4; j++)
+        {
+            unsigned bit = offset + (4 * half + j) * width;
+            int8_t byte = bit / BYTE_LEN - base[half];
+            for (int k = 0; k < 4; k++) shuffle[16 * half + 4 * j + k] = msb ? byte + 3 - k : byte + k;
+
+            /* LSB: Shift value down to bit 0, MSB: Shift value's top bit up to bit 31 */
+            shift[4 * half + j] = bit % BYTE_LEN;
+        }
+    }
+
+    int kernels = activeKernels();
+    if (kernels & BF_KERNEL_AVX2)  return unpackAVX2(src, count, width, msb, dst, shuffle, shift, base);
+    if (kernels & BF_KERNEL_SSE41) return unpackSSE41(src, count, width, msb, dst, shuffle, shift, base);
+#endif
+    (void)src; (void)offset; (void)count; (void)width; (void)msb; (void)dst;
+    return 0;
+}
+
+#ifdef X86_KERNELS
+/* unpackVector kernel: 8 values per step in one AVX2 register */
+KERNEL_TARGET("avx2") size_t unpackAVX2(const byte_t* src, size_t count, unsigned width, bool msb, uint32_t* dst, const int8_t* shuffle, const int32_t* shift, const size_t* base)
+{
+    __m256i pattern = _mm256_loadu_si256((const __m256i*)shuffle);
+    __m256i shifts = _mm256_loadu_si256((const __m256i*)shift);
+    __m256i mask = _mm256_set1_epi32((int32_t)LOW_MASK(width));
+    if (msb) shifts = _mm256_sub_epi32(_mm256_set1_epi32(32 - width), shifts);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8, src += width)
+    {
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src + base[0]))),
+                                                _mm_loadu_si128((const __m128i*)(src + base[1])), 1);
+        __m256i values = _mm256_srlv_epi32(_mm256_shuffle_epi8(bytes, pattern), shifts);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(values, mask));
+    }
+    return i;
+}
+
+/* unpackVector kernel: 8 values per step in two SSE4.1 registers */
+KERNEL_TARGET("sse4.1") size_t unpackSSE41(const byte_t* src, size_t count, unsigned width, bool msb, uint32_t* dst, const int8_t* shuffle, const int32_t* shift, const size_t* base)
+{
+    /* No variable shift: multiply by a power of 2 to line every lane up, then shift by a constant */
+    int32_t scale[8];
+    for (int j = 0; j < 8; j++) scale[j] = msb ? 1 << shift[j] : 1 << (BYTE_LEN - 1 - shift[j]);
+
+    __m128i pattern[2] = { _mm_loadu_si128((const __m128i*)shuffle), _mm_loadu_si128((const __m128i*)(shuffle + 16)) };
+    __m128i scales[2] = { _mm_loadu_si128((const __m128i*)scale), _mm_loadu_si128((const __m128i*)(scale + 4)) };
+    __m128i mask = _mm_set1_epi32((int32_t)LOW_MASK(width));
+    __m128i align = _mm_cvtsi32_si128(msb ? 32 - width : BYTE_LEN - 1);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8, src += width)
+    {
+        for (int half = 0; half < 2; half++)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(src + base[half]));
+            __m128i values = _mm_mullo_epi32(_mm_shuffle_epi8(bytes, pattern[half]), scales[half]);
+            values = _mm_srl_epi32(values, align);
+            if (!msb) values = _mm_and_si128(values, mask);
+            _mm_storeu_si128((__m128i*)(dst + i + 4 * half), values);
+        }
+    }
+    return i;
+}
+
+/* unpackBits kernel: unpackScalar taking each value with shrx & bzhi */
+KERNEL_TARGET("bmi2") size_t unpackBMI2(const byte_t* src, uint8_t offset, size_t i, size_t count, unsigned width, bool msb, uint32_t* dst)
+{
+    for (; i < count; i++)
+    {
+        uint64_t bit = offset + (uint64_t)i * width;
+        uint64_t word = loadWord(src + bit / BYTE_LEN, msb);
+        uint8_t shift = bit % BYTE_LEN;
+        dst[i] = (uint32_t)_bzhi_u64(word >> (msb ? BITBUF_LEN - width - shift : shift), width);
+    }
+    return count;
+}
+#endif
+
+/* Write count width-bit values from src32 or src64
+    - Packs values behind the pending bits of the accumulator into a chunk, then writes its whole bytes
+    - Returns number of values written */
+size_t writePacked(BITFILE* bitfile, const uint32_t* src32, const uint64_t* src64, size_t count, unsigned width)
+{
+    if (!(bitfile->_flags & BF_FLAG_WRITE))
+    {
+        badAccess(bitfile, src32 ? (void*)src32 : (void*)src64, true);
+        return 0;
+    }
+    if (!count || startWrite(bitfile)) return 0;
+
+    size_t done = 0;
+
+    /* Short runs go straight into the accumulator */
+    if ((uint64_t)count * width < PACK_MIN)
+    {
+        for (; done < count; done++)
+        {
+            if (bfputbits(bitfile, src32 ? src32[done] : src64[done], width) != (int)width) break;
+        }
+        return done;
+    }
+
+    /* Leave room for the whole bytes already pending in the accumulator */
+    byte_t chunk[BF_PACK_CHUNK + PACK_PAD];
+    size_t per_chunk = (size_t)(BF_PACK_CHUNK - BITBUF_LEN / BYTE_LEN) * BYTE_LEN / width;
+    while (done < count)
+    {
+        size_t values = count - done < per_chunk ? count - done : per_chunk;
+        size_t size = packBits(bitfile, src32 ? src32 + done : NULL, src64 ? src64 + done : NULL, values, width, chunk);
+        if (writeBytes(bitfile, chunk, size) < size) return done;
+        done += values;
+        BF_COUNT(bitfile, bits_written, (uint64_t)values * width);
+    }
+    return done;
+}
+
+/* Append count width-bit values to the accumulator, storing whole bytes in dst
+    - Accumulator keeps the final partial byte
+    - Returns number of bytes stored in dst (dst must have PACK_PAD bytes of slack) */
+size_t packBits(BITFILE* bitfile, const uint32_t* src32, const uint64_t* src64, size_t count, unsigned width, byte_t* dst)
+{
+    byte_t* out = dst;
+    size_t i = src32 ? packVector(bitfile, src32, count, width, &out) : 0;
+#ifdef X86_KERNELS
+    if (activeKernels() & BF_KERNEL_BMI2) i = packBMI2(bitfile, src32, src64, i, count, width, &out);
+#endif
+    packScalar(bitfile, src32, src64, i, count, width, &out);
+
+    uint8_t bytes = bitfile->_bitcount / BYTE_LEN;
+    storeWord(out, bitfile->_bitbuf, bitfile->_flags & BF_FLAG_MSB);
+    takeBits(bitfile, bytes * BYTE_LEN);
+    return out + bytes - dst;
+}
+
+/* Combine groups of values in vector lanes before appending them
+    - 4 values per append up to 14 bits wide, 2 values per append up to 28 bits wide
+    - Returns number of values appended (0 without SSE2/AVX2 or for wide values) */
+size_t packVector(BITFILE* bitfile, const uint32_t* src, size_t count, unsigned width, byte_t** out)
+{
+#ifdef X86_KERNELS
+    if (2 * width > BITBUF_LEN - BYTE_LEN) return 0;
+
+    int kernels = activeKernels();
+    if (kernels & BF_KERNEL_AVX2) return packAVX2(bitfile, src, count, width, out);
+    if (kernels & BF_KERNEL_SSE2) return packSSE2(bitfile, src, count, width, out);
+#endif
+    (void)bitfile; (void)src; (void)count; (void)width; (void)out;
+    return 0;
+}
+
+#ifdef X86_KERNELS
+/* packVector kernel: 8 values per step in one AVX2 register */
+KERNEL_TARGET("avx2") size_t packAVX2(BITFILE* bitfile, const uint32_t* src, size_t count, unsigned width, byte_t** out)
+{
+    bool msb = bitfile->_flags & BF_FLAG_MSB;
+    bool quads = 4 * width <= BITBUF_LEN - BYTE_LEN;
+    uint64_t bitbuf = bitfile->_bitbuf;
+    unsigned bitcount = bitfile->_bitcount;
+    __m128i pair_shift = _mm_cvtsi32_si128(width);
+    __m128i quad_shift = _mm_cvtsi32_si128(2 * width);
+    __m256i mask = _mm256_set1_epi32((int32_t)LOW_MASK(width));
+    __m256i low = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        /* Join neighboring 32-bit lanes into one 64-bit lane (First value is most significant when MSB) */
+        __m256i values = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(src + i)), mask);
+        __m256i first = _mm256_and_si256(values, low), second = _mm256_srli_epi64(values, 32);
+        __m256i pairs = msb ? _mm256_or_si256(_mm256_sll_epi64(first, pair_shift), second)
+                            : _mm256_or_si256(first, _mm256_sll_epi64(second, pair_shift));
+        if (quads)
+        {
+            __m256i next = _mm256_srli_si256(pairs, 8);
+            __m256i joined = msb ? _mm256_or_si256(_mm256_sll_epi64(pairs, quad_shift), next)
+                                 : _mm256_or_si256(pairs, _mm256_sll_epi64(next, quad_shift));
+            appendWord(&bitbuf, &bitcount, _mm256_extract_epi64(joined, 0), 4 * width, msb, out);
+            appendWord(&bitbuf, &bitcount, _mm256_extract_epi64(joined, 2), 4 * width, msb, out);
+        }
+        else
+        {
+            uint64_t pair[4];
+            _mm256_storeu_si256((__m256i*)pair, pairs);
+            for (int lane = 0; lane < 4; lane++) appendWord(&bitbuf, &bitcount, pair[lane], 2 * width, msb, out);
+        }
+    }
+    bitfile->_bitbuf = bitbuf;
+    bitfile->_bitcount = bitcount;
+    return i;
+}
+
+/* packVector kernel: 4 values per step in one SSE2 register */
+KERNEL_TARGET("sse2") size_t packSSE2(BITFILE* bitfile, const uint32_t* src, size_t count, unsigned width, byte_t** out)
+{
+    bool msb = bitfile->_flags & BF_FLAG_MSB;
+    bool quads = 4 * width <= BITBUF_LEN - BYTE_LEN;
+    uint64_t bitbuf = bitfile->_bitbuf;
+    unsigned bitcount = bitfile->_bitcount;
+    __m128i pair_shift = _mm_cvtsi32_si128(width);
+    __m128i quad_shift = _mm_cvtsi32_si128(2 * width);
+    __m128i mask = _mm_set1_epi32((int32_t)LOW_MASK(width));
+    __m128i low = _mm_set1_epi64x(0xFFFFFFFF);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        /* Join neighboring 32-bit lanes into one 64-bit lane (First value is most significant when MSB) */
+        __m128i values = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i)), mask);
+        __m128i first = _mm_and_si128(values, low), second = _mm_srli_epi64(values, 32);
+        __m128i pairs = msb ? _mm_or_si128(_mm_sll_epi64(first, pair_shift), second)
+                            : _mm_or_si128(first, _mm_sll_epi64(second, pair_shift));
+        __m128i next = _mm_srli_si128(pairs, 8);
+        if (quads)
+        {
+            __m128i joined = msb ? _mm_or_si128(_mm_sll_epi64(pairs, quad_shift), next)
+                                 : _mm_or_si128(pairs, _mm_sll_epi64(next, quad_shift));
+            appendWord(&bitbuf, &bitcount, _mm_cvtsi128_si64(joined), 4 * width, msb, out);
+        }
+        else
+        {
+            appendWord(&bitbuf, &bitcount, _mm_cvtsi128_si64(pairs), 2 * width, msb, out);
+            appendWord(&bitbuf, &bitcount, _mm_cvtsi128_si64(next), 2 * width, msb, out);
+        }
+    }
+    bitfile->_bitbuf = bitbuf;
+    bitfile->_bitcount = bitcount;
+    return i;
+}
+
+/* packBits kernel: packScalar built for BMI2 (Variable shifts become shlx & shrx) */
+KERNEL_TARGET("bmi2") size_t packBMI2(BITFILE* bitfile, const uint32_t* src32, const uint64_t* src64, size_t i, size_t count, unsigned width, byte_t** out)
+{
+    return packScalar(bitfile, src32, src64, i, count, width, out);
+}
+#endif
+
+/* Append values i up to count to the accumulator, storing its whole bytes at *out when full (Inlined into each scalar kernel)
+    - Returns count */
+KERNEL_INLINE size_t packScalar(BITFILE* bitfile, const uint32_t* src32, const uint64_t* src64, size_t i, size_t count, unsigned width, byte_t** out)
+{
+    /* Values too wide to follow a partial byte are appended in halves */
+    if (width > BITBUF_LEN - BYTE_LEN)
+    {
+        for (; i < count; i++) appendBits(bitfile, width < BITBUF_LEN ? src64[i] & LOW_MASK(width) : src64[i], width, out);
+        return count;
+    }
+
+    /* Accumulator is kept in registers until the run ends */
+    bool msb = bitfile->_flags & BF_FLAG_MSB;
+    uint64_t bitbuf = bitfile->_bitbuf;
+    unsigned bitcount = bitfile->_bitcount;
+    for (; i < count; i++) appendWord(&bitbuf, &bitcount, (src32 ? src32[i] : src64[i]) & LOW_MASK(width), width, msb, out);
+
+    bitfile->_bitbuf = bitbuf;
+    bitfile->_bitcount = bitcount;
+    return count;
+}
+
+/* Append count bits (Up to 56) to a register copy of the accumulator, first storing its whole bytes at *out if there's no room */
+KERNEL_INLINE void appendWord(uint64_t* bitbuf, unsigned* bitcount, uint64_t bits, unsigned count, bool msb, byte_t** out)
+{
+    if (*bitcount + count > BITBUF_LEN)
+    {
+        unsigned stored = *bitcount / BYTE_LEN * BYTE_LEN;
+        storeWord(*out, *bitbuf, msb);
+        *out += stored / BYTE_LEN;
+        if (stored == BITBUF_LEN) *bitbuf = 0;
+        else *bitbuf = msb ? *bitbuf << stored : *bitbuf >> stored;
+        *bitcount -= stored;
+    }
+    *bitbuf |= msb ? bits << (BITBUF_LEN - count - *bitcount) : bits << *bitcount;
+    *bitcount += count;
+}
+
+/* Append bits to the accumulator, first storing its whole bytes at *out if there's no room */
+void appendBits(BITFILE* bitfile, uint64_t bits, uint8_t count, byte_t** out)
+{
+    bool msb = bitfile->_flags & BF_FLAG_MSB;
+    if (bitfile->_bitcount + count > BITBUF_LEN)
+    {
+        uint8_t bytes = bitfile->_bitcount / BYTE_LEN;
+        storeWord(*out, bitfile->_bitbuf, msb);
+        *out += bytes;
+        takeBits(bitfile, bytes * BYTE_LEN);
+    }
+
+    /* Value too wide to follow a partial byte: append in halves */
+    if (bitfile->_bitcount + count > BITBUF_LEN)
+    {
+        uint8_t high = count - 32;
+        if (msb)
+        {
+            appendBits(bitfile, bits >> 32, high, out);
+            appendBits(bitfile, bits & LOW_MASK(32), 32, out);
+        }
+        else
+        {
+            appendBits(bitfile, bits & LOW_MASK(32), 32, out);
+            appendBits(bitfile, bits >> 32, high, out);
+        }
+        return;
+    }
+    putBits(bitfile, bits, count);
+}
+
+/* Store a word as 8 bytes in stream order (MSB: big-endian, LSB: little-endian) */
+void storeWord(byte_t* dst, uint64_t word, bool msb)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (msb) word = __builtin_bswap64(word);
+#else
+    if (!msb) word = __builtin_bswap64(word);
+#endif
+    memcpy(dst, &word, sizeof(word));
+}
+
+/* Load 8 bytes as a word in stream order (MSB: big-endian, LSB: little-endian) */
+uint64_t loadWord(const byte_t* src, bool msb)
+{
+    uint64_t word;
+    memcpy(&word, src, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return msb ? __builtin_bswap64(word) : word;
+#else
+    return msb ? word : __builtin_bswap64(word);
+#endif
+}
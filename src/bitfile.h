@@ -19,13 +19,29 @@ READ BITS by bathtaters
 #define PRINT_BYTE_SPACES true
 /* Access mode for temp file */
 #define TMP_FILE_ACCESS "wb+"
+/* Default buffer size for descriptor backend (Access mode 'd') */
+#define BF_BUFSIZ 65536
+/* Memory alignment of buffers allocated by descriptor backend */
+#define BF_BUFALIGN 4096
+/* Bytes (un)packed per pass by packed array functions */
+#define BF_PACK_CHUNK 4096
+/* Default bits looked up at once by prefix code tables */
+#define BF_HUFF_ROOT 10
+/* Locks guarding bytes shared by neighbouring records of a shared bitfile (bfshare) */
+#define BF_SHARE_LOCKS 64
+/* Count I/O statistics for bfstats (Define as 1 when building the library & its callers, the BITFILE layout doesn't change) */
+#ifndef BF_STATS
+#define BF_STATS 0
+#endif
 
 /* -- CONSTANTS & MACROS -- */
 
 /* Max size of access_mode (including NUL) */
-#define ACCESS_MODE_LEN 4
+#define ACCESS_MODE_LEN 5
 /* Length of 1 byte in bits */
 #define BYTE_LEN 8
+/* Length of the bit accumulator in bits */
+#define BITBUF_LEN 64
 /* x / y rounded up to nearest whole number (Expects integer x & y) */
 #define CEIL_DIV(x,y) (1 + (((x) - 1) / (y)))
 
@@ -35,9 +51,73 @@ READ BITS by bathtaters
 #define BF_FLAG_WRITE 0x2
 /* Flag bit representing if bits are read from left to right */
 #define BF_FLAG_MSB 0x4
+/* Flag bit representing end-of-file reached */
+#define BF_FLAG_EOF 0x8
+/* Flag bit representing unwritten bits held in bit accumulator */
+#define BF_FLAG_DIRTY 0x10
+/* Flag bit representing unwritten bytes held in descriptor buffer */
+#define BF_FLAG_BUFDIRTY 0x20
+/* Flag bit representing bits are read toward the start of the file (bfreverse) */
+#define BF_FLAG_BACK 0x40
+/* If bits are taken from the top of the bit accumulator (MSB first forward or LSB first backward) */
+#define BF_TOP_FIRST(flags) (!((flags) & BF_FLAG_MSB) != !((flags) & BF_FLAG_BACK))
+
+/* Byte I/O through stdio FILE object */
+#define BF_BACKEND_STDIO 0
+/* Byte I/O through raw file descriptor & BITFILE-owned buffer */
+#define BF_BACKEND_FD 1
+/* Byte I/O served from a read-only memory mapping of the file */
+#define BF_BACKEND_MMAP 2
+/* Byte I/O on a memory buffer (bfmemopen) */
+#define BF_BACKEND_MEM 3
+
+/* Access pattern hints for bfadvise */
+#define BF_ADVISE_NORMAL 0
+#define BF_ADVISE_SEQUENTIAL 1
+#define BF_ADVISE_RANDOM 2
+#define BF_ADVISE_WILLNEED 3
+/* Sequential, reading the next buffer in the background while the current one is read (Descriptor backend) */
+#define BF_ADVISE_READAHEAD 4
+/* Full buffers are written in the background while the next one is filled (Descriptor backend) */
+#define BF_ADVISE_WRITEBEHIND 5
+
+/* Calls traced by bftrace & timed by bftimeops */
+#define BF_OP_READ 0
+#define BF_OP_WRITE 1
+#define BF_OP_SEEK 2
+#define BF_OP_FLUSH 3
+/* Number of traced call types */
+#define BF_OPS 4
+/* Buckets in each latency histogram (Bucket n counts calls taking 2^(n-1) up to 2^n - 1 ns) */
+#define BF_LATENCY_BUCKETS 32
+
+/* x86-64 extensions used by bit kernels (bfkernels) */
+#define BF_KERNEL_SSE2 0x1
+#define BF_KERNEL_SSE41 0x2
+#define BF_KERNEL_AVX2 0x4
+#define BF_KERNEL_BMI2 0x8
+#define BF_KERNEL_ALL 0xF
+
+/* Longest code accepted by prefix code tables */
+#define BF_HUFF_MAXLEN 24
+
+/* Precision of range coder probabilities in bits */
+#define BF_PROB_BITS 11
+/* Adaptation rate of range coder probabilities (Higher adapts slower) */
+#define BF_PROB_SHIFT 5
+/* Starting range coder probability (Even odds) */
+#define BF_PROB_INIT (1 << (BF_PROB_BITS - 1))
+
 /* Flag bit representing error */
 #define BF_FLAG_ERR 0x80
 
+/* Add n to a counter of the bitfile's statistics (Compiles to nothing unless BF_STATS) */
+#if BF_STATS
+#define BF_COUNT(bitfile, counter, n) ((bitfile)->_stats.counter += (n))
+#else
+#define BF_COUNT(bitfile, counter, n) ((void)0)
+#endif
+
 /* -- DATA TYPES -- */
 
 /* Type used to store raw byte */
@@ -61,24 +141,164 @@ typedef struct bfpos_t {
     uint8_t bit;
 } bfpos_t;
 
+/* I/O statistics of a bitfile (bfstats) */
+typedef struct bfstats_t {
+    /* Bits returned by read functions */
+    uint64_t bits_read;
+    /* Bits taken by write functions */
+    uint64_t bits_written;
+    /* Bytes taken from the backend (File, buffer or memory) */
+    uint64_t bytes_read;
+    /* Bytes given to the backend */
+    uint64_t bytes_written;
+    /* Descriptor buffer refills */
+    uint64_t refills;
+    /* System calls made for byte I/O & seeking */
+    uint64_t syscalls;
+    /* Calls made into stdio (Stdio backend) */
+    uint64_t stdio_calls;
+    /* Byte cursor moves served within the buffer or memory */
+    uint64_t buffer_seeks;
+    /* Byte cursor moves that left the buffer or went through stdio */
+    uint64_t file_seeks;
+    /* Partial bytes read back & merged with new bits */
+    uint64_t merges;
+    /* Times the end-of-file indicator was set */
+    uint64_t eofs;
+    /* Times the error indicator was set */
+    uint64_t errors;
+} bfstats_t;
+
+/* Latency histograms of traced calls, indexed by BF_OP_* (bflatency) */
+typedef struct bflatency_t {
+    /* Number of calls taking 2^(n-1) up to 2^n - 1 ns in bucket n (Last bucket also counts longer calls) */
+    uint64_t buckets[BF_OPS][BF_LATENCY_BUCKETS];
+    /* Total time spent in calls in ns */
+    uint64_t total_ns[BF_OPS];
+    /* Longest call in ns */
+    uint64_t max_ns[BF_OPS];
+} bflatency_t;
+
+/* Callback at the start (end = false) & end of each traced call (bftrace) */
+struct BITFILE;
+typedef void (*bftrace_t)(struct BITFILE* bitfile, int op, bool end, void* arg);
+
+/* State of a bitfile shared by concurrent writers (bfshare) */
+typedef struct bfwriters_t bfwriters_t;
+/* Second buffer read or written in the background (BF_ADVISE_READAHEAD, BF_ADVISE_WRITEBEHIND) */
+typedef struct bfasync_t bfasync_t;
+/* Read & write calls built for one bit order & direction (Bound when opened & by bfreverse) */
+typedef struct bfengine_t bfengine_t;
+
 /* Data object for bitfile functions
    (DO NOT modify this directly!) */
 typedef struct BITFILE {
-    /* File object to read from */
+    /* File object to read from (Stdio backend) */
     FILE* _fileobj;
-    /* Current byte being read */
-    int _currbyte;
-    /* Current bit offset within this.byte */
-    int8_t _bitoffset;
+    /* File descriptor to read from (Descriptor backend) */
+    int _fd;
+    /* Byte buffer (Descriptor backend), file mapping (Mapped backend) or memory (Memory backend) */
+    byte_t* _buf;
+    /* Size of this._buf */
+    size_t _bufsize;
+    /* Number of valid bytes in this._buf */
+    size_t _buflen;
+    /* Byte cursor within this._buf */
+    size_t _bufpos;
+    /* File offset of this._buf[0] */
+    int64_t _bufstart;
+    /* If this._buf was allocated by BITFILE */
+    bool _bufowned;
+    /* If this._fd or mapping belongs to the bitfile this was opened from (bfopenrange) */
+    bool _shared;
+    /* If writes go to the end of file (Descriptor append modes, which don't open with O_APPEND) */
+    bool _append;
+    /* File offset reads stop at (End of range for bfopenrange, otherwise INT64_MAX) */
+    int64_t _end;
+    /* Shared writer state (NULL unless shared by bfshare) */
+    bfwriters_t* _writers;
+    /* Background I/O state (NULL unless advised BF_ADVISE_READAHEAD or BF_ADVISE_WRITEBEHIND) */
+    bfasync_t* _async;
+    /* Backend used for byte I/O (BF_BACKEND_*) */
+    uint8_t _backend;
+    /* Bit accumulator holding bits read ahead of the cursor (Or pending output if BF_FLAG_DIRTY)
+        - MSB first: bits are packed from the top of the word
+        - LSB first: bits are packed from the bottom of the word */
+    uint64_t _bitbuf;
+    /* Number of valid bits in this._bitbuf */
+    uint8_t _bitcount;
     /* Flag descriptors for bit file */
     uint8_t _flags;
+    /* Read & write engine for the bit order & direction in this._flags */
+    const bfengine_t* _engine;
+    /* I/O statistics (bfstats, Only counted if BF_STATS) */
+    bfstats_t _stats;
+    /* Latency histograms of traced calls (Kept while this._timed) */
+    bflatency_t _latency;
+    /* Callback at the start & end of each traced call (bftrace) */
+    bftrace_t _trace;
+    /* Argument passed to this._trace */
+    void* _tracearg;
+    /* If traced calls are timed into this._latency (bftimeops) */
+    bool _timed;
 } BITFILE;
 
+/* Lookup table entry of a prefix code table */
+typedef struct bfhuffentry_t {
+    /* Symbol, or offset of sub-table (Sub-table entry) */
+    uint32_t value;
+    /* Code length in bits (0 if no code starts with these bits), or bits indexed before sub-table */
+    uint8_t length;
+    /* Index bits of sub-table (0 for symbol entry) */
+    uint8_t sub;
+} bfhuffentry_t;
+
+/* Canonical prefix code table (Build with bfhuffbuild)
+   (DO NOT modify this directly!) */
+typedef struct bfhuff_t {
+    /* Root table followed by sub-tables (Each indexed by up to this._rootbits more bits) */
+    bfhuffentry_t* _table;
+    /* Code of each symbol in stream order (For bfencodesym) */
+    uint32_t* _codes;
+    /* Code length of each symbol (0 if unused) */
+    uint8_t* _lengths;
+    /* Number of symbols */
+    size_t _symbols;
+    /* Index bits of root table */
+    uint8_t _rootbits;
+    /* Longest code length */
+    uint8_t _maxlen;
+    /* Bit order the table was built for */
+    bool _msb;
+} bfhuff_t;
+
+/* Adaptive probability that the next bit of a context is 0 (Out of 1 << BF_PROB_BITS) */
+typedef uint16_t bfprob_t;
+
+/* Binary range coder over a bitfile (Start with bfrangeenc or bfrangedec)
+   (DO NOT modify this directly!) */
+typedef struct bfrange_t {
+    /* Bitfile that coded bytes are written to or read from */
+    BITFILE* _bitfile;
+    /* Low end of the encoder interval (Bits 32+ carry into pending bytes) */
+    uint64_t _low;
+    /* Number of bytes held back until carries are resolved (Encoder) */
+    uint64_t _cachesize;
+    /* Width of the current interval */
+    uint32_t _range;
+    /* Offset of the coded value within the interval (Decoder) */
+    uint32_t _code;
+    /* First byte held back (Encoder) */
+    uint8_t _cache;
+} bfrange_t;
+
 
 /* -- OPEN/CLOSE FUNCTIONS -- */
 
 /* Opens the file pointed to by filename using the given mode & bit order
     - Access Modes: r, w, a, r+, w+, a+
+    - Append 'd' to bypass stdio using a raw file descriptor & BITFILE-owned buffer
+    - Append 'm' to read from a memory mapping of the file (Read-only: r, rb)
     - MSB_First = true: Most-Sig Bit First (Left-to-right)
     - MSB_First = false: Least-Sig Bit First (Right-to-left) */
 BITFILE* bfopen(const char* filename, const char* access_mode, bool msb_first);
@@ -89,6 +309,23 @@ BITFILE* bfreopen(const char* filename, const char* access_mode, bool msb_first,
 /* Creates a temporary file in update mode (wb+).
     - nametemplate must end with "XXXXXX" */
 BITFILE* tmpbitfile(char* nametemplate, bool msb_first);
+/* Opens a bitfile over size bytes of memory at buf using the given mode & bit order
+    - Access Modes: r, w, a, r+, w+, a+ (w starts empty, a starts at the end)
+    - buf = NULL: Use a heap buffer that grows as it is written (Freed by bfclose) */
+BITFILE* bfmemopen(void* buf, size_t size, const char* access_mode, bool msb_first);
+/* Returns memory of a bfmemopen bitfile & sets size to the number of bytes held
+    - Writes out pending bits first (Heap buffer may move as it grows) */
+void* bfmembuf(BITFILE* bitfile, size_t* size);
+/* Opens a read-only handle over number_of_bits of bitfile starting at start_bit
+    - Has its own cursor & buffer but shares the file descriptor or mapping, so each thread can read its own range
+    - Positions are still counted from the start of file, reads past the range hit EOF
+    - The range ends at a byte boundary (Up to 7 bits after it can still be read)
+    - bitfile must stay open until the handle is closed */
+BITFILE* bfopenrange(BITFILE* bitfile, bpos_t start_bit, bsize_t number_of_bits);
+/* Opens count handles (bfopenrange) splitting bitfile at the count + 1 bit positions in bounds
+    - Handle n reads from bounds[n] up to bounds[n + 1]
+    - Returns 0 on success, EOF on failure (No handles are left open) */
+int bfsplit(BITFILE* bitfile, const bpos_t* bounds, size_t count, BITFILE** handles);
 
 
 /* --- READ/WRITE FUNCTIONS --- */
@@ -98,17 +335,167 @@ BITFILE* tmpbitfile(char* nametemplate, bool msb_first);
 bsize_t bfread(void* ptr, bsize_t number_of_bits, BITFILE* bitfile);
 /* Writes data from the array pointed to by 'ptr' to the given 'bitfile.' */
 bsize_t bfwrite(void* ptr, bsize_t number_of_bits, BITFILE* bitfile);
+/* Reads number_of_bits starting bit_offset bits into the file into ptr, stored like bfread
+    - Doesn't use or move the cursor, so many threads can read one bitfile at once
+    - Reads the file itself (Bits written at the cursor aren't seen until bfflush)
+    - Returns number of bits read (Fewer at EOF or on error) */
+bsize_t bfpread(BITFILE* bitfile, void* ptr, bsize_t number_of_bits, bpos_t bit_offset);
+/* Writes number_of_bits from ptr (Stored like bfwrite) starting bit_offset bits into the file
+    - Doesn't use or move the cursor, so many threads can write one bitfile at once
+    - Bytes partly written are read & merged, so concurrent writes must not share a byte (Unless shared by bfshare)
+    - Memory bitfiles are only written within the bytes they hold
+    - Descriptor bitfiles update their buffered copy too, so cursor reads & flushes see the write
+    - Returns number of bits written (Fewer on error) */
+bsize_t bfpwrite(BITFILE* bitfile, const void* ptr, bsize_t number_of_bits, bpos_t bit_offset);
+/* Starts (shared = true) or ends sharing bitfile between threads appending records with bfreserve & bfpwrite
+    - Records are appended from the cursor, ending moves the cursor after the last record reserved
+    - While shared, bfpwrite safely merges bytes shared by neighbouring records & cursor writes fail with EINVAL
+    - Memory bitfiles don't grow while shared (Records past their size fail with ENOSPC)
+    - Returns 0 on success */
+int bfshare(BITFILE* bitfile, bool shared);
+/* Reserves the next number_of_bits of a shared bitfile (Safe to call from many threads at once)
+    - Returns bit position to bfpwrite the record at, or -1 if bitfile isn't shared */
+bpos_t bfreserve(BITFILE* bitfile, bsize_t number_of_bits);
 /* Flushes output buffer of the bitfile to file. */
 int bfflush(BITFILE* bitfile);
+/* Hint how the bitfile will be accessed (BF_ADVISE_*)
+    - Mapped backend passes hint to the mapping, others to the file where supported
+    - BF_ADVISE_READAHEAD fetches the next buffer asynchronously (Descriptor backend, other hints stop it)
+    - BF_ADVISE_WRITEBEHIND writes full buffers asynchronously, bfflush & bfclose wait for them (Descriptor backend) */
+int bfadvise(BITFILE* bitfile, int advice);
 /* Define how the bitfile should be buffered.
     - buffer should be array of size 'size' (or NULL to use internal buffer)
-    - mode should be _IOFBF (Full buffer) or _IONBF (No buffer) */
+    - mode should be _IOFBF (Full buffer) or _IONBF (No buffer)
+    - Descriptor backend allocates internal buffer aligned to BF_BUFALIGN */
 int setbfbuf(BITFILE* bitfile, char* buffer, int mode, size_t size);
 
+/* --- BIT FIELD FUNCTIONS --- */
+
+/* Reads number_of_bits (0-64) from bitfile as an integer
+    - MSB first: first bit read is most significant, LSB first: first bit read is least significant
+    - Returns fewer bits (right-aligned) at EOF, check bfeof */
+static inline uint64_t bfgetbits(BITFILE* bitfile, unsigned number_of_bits);
+/* Reads number_of_bits (1-64) from bitfile as a sign-extended integer */
+static inline int64_t bfgetsbits(BITFILE* bitfile, unsigned number_of_bits);
+/* Writes the lowest number_of_bits (0-64) of value to bitfile
+    - Returns number of bits written */
+static inline int bfputbits(BITFILE* bitfile, uint64_t value, unsigned number_of_bits);
+/* Writes the lowest number_of_bits (1-64) of signed value to bitfile
+    - Returns number of bits written */
+static inline int bfputsbits(BITFILE* bitfile, int64_t value, unsigned number_of_bits);
+/* Returns the next number_of_bits (0-64) of bitfile without moving the cursor
+    - Bits past EOF read as 0 */
+static inline uint64_t bfpeekbits(BITFILE* bitfile, unsigned number_of_bits);
+/* Moves the cursor forward (Backward if reading backward) by number_of_bits
+    - Only seeks the file once the skip runs past the bits already read ahead
+    - Returns 0 on success, same as bfseek */
+static inline int bfskipbits(BITFILE* bitfile, bsize_t number_of_bits);
+/* Reads bits for bfgetbits when the bit accumulator can't supply them */
+uint64_t bfrefillbits(BITFILE* bitfile, unsigned number_of_bits);
+/* Writes bits for bfputbits when the bit accumulator can't take them */
+int bfspillbits(BITFILE* bitfile, uint64_t value, unsigned number_of_bits);
+/* Reads ahead for bfpeekbits when the bit accumulator can't supply the bits */
+uint64_t bfrefillpeek(BITFILE* bitfile, unsigned number_of_bits);
+/* Skips for bfskipbits when the bit accumulator doesn't hold the whole skip */
+int bfrefillskip(BITFILE* bitfile, bsize_t number_of_bits);
+
+/* --- VARIABLE-LENGTH CODE FUNCTIONS --- */
+
+/* Codes are a run of 0 bits ended by a 1 bit, then an info field in bfgetbits order
+    - Decoders return 0 & set errno to ERANGE if the code doesn't fit in 64 bits, check bfeof for EOF
+    - Encoders return number of bits written */
+
+/* Reads a unary code: value 0 bits followed by a 1 bit */
+uint64_t bfgetunary(BITFILE* bitfile);
+/* Writes value as a unary code */
+bsize_t bfputunary(BITFILE* bitfile, uint64_t value);
+/* Reads an order k Exp-Golomb code */
+uint64_t bfgetexpgolomb(BITFILE* bitfile, unsigned k);
+/* Writes value as an order k Exp-Golomb code */
+bsize_t bfputexpgolomb(BITFILE* bitfile, uint64_t value, unsigned k);
+/* Reads an Elias gamma code (Values start at 1) */
+uint64_t bfgetgamma(BITFILE* bitfile);
+/* Writes value (>= 1) as an Elias gamma code */
+bsize_t bfputgamma(BITFILE* bitfile, uint64_t value);
+/* Reads an Elias delta code (Values start at 1) */
+uint64_t bfgetdelta(BITFILE* bitfile);
+/* Writes value (>= 1) as an Elias delta code */
+bsize_t bfputdelta(BITFILE* bitfile, uint64_t value);
+/* Reads a Golomb-Rice code with parameter k (Unary quotient, k-bit remainder) */
+uint64_t bfgetrice(BITFILE* bitfile, unsigned k);
+/* Writes value as a Golomb-Rice code with parameter k */
+bsize_t bfputrice(BITFILE* bitfile, uint64_t value, unsigned k);
+
+/* --- PREFIX CODE FUNCTIONS --- */
+
+/* Builds canonical prefix code (Huffman) tables from the code length of each symbol
+    - lengths of 0 mark unused symbols, max length is BF_HUFF_MAXLEN
+    - root_bits (1-16) are looked up in one step, 0 uses BF_HUFF_ROOT
+    - msb_first must match the bit order of files the table will be used with
+    - Returns NULL if the lengths don't form a prefix code */
+bfhuff_t* bfhuffbuild(const uint8_t* lengths, size_t symbols, bool msb_first, unsigned root_bits);
+/* Frees tables created by bfhuffbuild */
+void bfhufffree(bfhuff_t* table);
+/* Reads one symbol from bitfile
+    - Returns symbol, or EOF at end of file or on an invalid code */
+int bfdecodesym(BITFILE* bitfile, const bfhuff_t* table);
+/* Reads count symbols from bitfile into out
+    - Returns number of symbols read (Fewer at EOF or on an invalid code) */
+size_t bfdecodesyms(BITFILE* bitfile, const bfhuff_t* table, uint16_t* out, size_t count);
+/* Writes the code of symbol to bitfile
+    - Returns number of bits written (0 if symbol has no code) */
+bsize_t bfencodesym(BITFILE* bitfile, const bfhuff_t* table, unsigned symbol);
+
+/* --- RANGE CODER FUNCTIONS --- */
+
+/* Coded bytes are read & written like bfgetbits/bfputbits with 8 bits, so a coded stream can start at any bit */
+
+/* Sets count probabilities to BF_PROB_INIT */
+void bfprobinit(bfprob_t* probs, size_t count);
+/* Starts encoding to bitfile at its current position
+    - Returns 0 on success */
+int bfrangeenc(bfrange_t* coder, BITFILE* bitfile);
+/* Encodes bit using (And updates) the probability of its context
+    - Returns 0 on success, EOF on a write error */
+int bfencbit(bfrange_t* coder, bfprob_t* prob, int bit);
+/* Writes the rest of the coded stream (Must be called after the last bfencbit)
+    - Returns 0 on success, EOF on a write error */
+int bfrangeflush(bfrange_t* coder);
+/* Starts decoding from bitfile at its current position
+    - Returns 0 on success, EOF if the bitfile isn't readable or ends first */
+int bfrangedec(bfrange_t* coder, BITFILE* bitfile);
+/* Decodes a bit using (And updates) the probability of its context
+    - Returns bit, or EOF if the coded stream ends early */
+int bfdecbit(bfrange_t* coder, bfprob_t* prob);
+
+/* --- PACKED ARRAY FUNCTIONS --- */
+
+/* Reads count consecutive width-bit (1-32) values from bitfile into dst
+    - Uses SSE4.1/AVX2/BMI2 kernels when the CPU has them
+    - Returns number of values read (Fewer at EOF) */
+size_t bfreadpacked(BITFILE* bitfile, uint32_t* dst, size_t count, unsigned width);
+/* Reads count consecutive width-bit (1-64) values from bitfile into dst
+    - Returns number of values read (Fewer at EOF) */
+size_t bfreadpacked64(BITFILE* bitfile, uint64_t* dst, size_t count, unsigned width);
+/* Writes the lowest width bits (1-32) of count values from src to bitfile
+    - Uses SSE2/AVX2/BMI2 kernels when the CPU has them
+    - Returns number of values written */
+size_t bfwritepacked(BITFILE* bitfile, const uint32_t* src, size_t count, unsigned width);
+/* Writes the lowest width bits (1-64) of count values from src to bitfile
+    - Returns number of values written */
+size_t bfwritepacked64(BITFILE* bitfile, const uint64_t* src, size_t count, unsigned width);
+/* Limits the bit kernels of packed array functions to the extensions in kernels (BF_KERNEL_*)
+    - Kernels are otherwise picked for the running CPU on first use
+    - BF_KERNEL_ALL uses every extension the CPU has, 0 uses portable code only
+    - Returns extensions now in use */
+int bfkernels(int kernels);
+
 /* --- POSITION FUNCTIONS --- */
 
 /* Sets the file position of the stream to the offsets from the whence position
     - Accepts negative offsets and bit_offset > 8
+    - Seeks within the bits read ahead don't touch the file, byte-aligned seeks read nothing until the next read
+    - Seeking into a byte past EOF fails & sets EOF (Byte-aligned seeks past EOF set it on the next read)
     - Whence: SEEK_CUR, SEEK_SET, SEEK_END */
 int bfseek(BITFILE* bitfile, bpos_t offset, int whence);
 /* Returns the current bit position of the given bit file. */
@@ -119,6 +506,12 @@ void bfrewind(BITFILE *bitfile);
 int bfgetpos(BITFILE *bitfile, bfpos_t* pos);
 /* Sets the file position of the given bit file to the given position. */
 int bfsetpos(BITFILE *bitfile, const bfpos_t* pos);
+/* Sets whether bits are read forward or backward (Toward the start of file), keeping the cursor in place
+    - Backward bfgetbits returns the bits before the cursor (In the same order bfputbits wrote them) & moves it back
+    - Positions stay counted from the start of file, bfeof is set at the start of file
+    - Writes, bfread & packed reads fail with EINVAL while reading backward
+    - Returns 0 on success */
+int bfreverse(BITFILE* bitfile, bool backward);
 
 /* --- ERROR FUNCTIONS --- */
 
@@ -129,6 +522,24 @@ int bferror(BITFILE* bitfile);
 /* Returns non-zero if the end-of-file indicator is set for the given bitfile. */
 int bfeof(BITFILE* bitfile);
 
+/* --- STATISTICS FUNCTIONS --- */
+
+/* Copies the I/O statistics counted since bitfile was opened (Or last cleared) to stats
+    - Returns 0 on success, -1 & sets errno to ENOTSUP unless built with BF_STATS */
+int bfstats(BITFILE* bitfile, bfstats_t* stats);
+/* Resets the I/O statistics & latency histograms of the given bitfile to 0 */
+void clearbfstats(BITFILE* bitfile);
+/* Calls callback with arg at the start & end of each bfread, bfwrite, bfseek & bfflush (op is BF_OP_*)
+    - callback = NULL: Stop tracing
+    - Returns 0 on success, -1 & sets errno to ENOTSUP unless built with BF_STATS */
+int bftrace(BITFILE* bitfile, bftrace_t callback, void* arg);
+/* Starts (timed = true) or stops timing traced calls into latency histograms
+    - Returns 0 on success, -1 & sets errno to ENOTSUP unless built with BF_STATS */
+int bftimeops(BITFILE* bitfile, bool timed);
+/* Copies the latency histograms of bitfile's traced calls to latency
+    - Returns 0 on success, -1 & sets errno to ENOTSUP unless built with BF_STATS */
+int bflatency(BITFILE* bitfile, bflatency_t* latency);
+
 /* -- UTILITY FUNCTIONS -- */
 
 /* Swap endianess of bin_data of length number_of_bits */
@@ -139,4 +550,91 @@ void fprintbin(FILE* stream, const void* bin_data, bsize_t number_of_bits);
 void printbin(const void* bin_data, bsize_t number_of_bits);
 
 
+/* -- INLINE DEFINITIONS -- */
+
+static inline uint64_t bfgetbits(BITFILE* bitfile, unsigned number_of_bits)
+{
+    /* Read straight from the accumulator while it holds enough read-ahead */
+    if (number_of_bits - 1 < bitfile->_bitcount &&
+        (bitfile->_flags & (BF_FLAG_READ | BF_FLAG_DIRTY | BF_FLAG_EOF)) == BF_FLAG_READ)
+    {
+        uint64_t bits;
+        bool whole = number_of_bits == BITBUF_LEN;
+
+        if (BF_TOP_FIRST(bitfile->_flags))
+        {
+            bits = bitfile->_bitbuf >> (BITBUF_LEN - number_of_bits);
+            bitfile->_bitbuf = whole ? 0 : bitfile->_bitbuf << number_of_bits;
+        }
+        else
+        {
+            bits = whole ? bitfile->_bitbuf : bitfile->_bitbuf & ((UINT64_C(1) << number_of_bits) - 1);
+            bitfile->_bitbuf = whole ? 0 : bitfile->_bitbuf >> number_of_bits;
+        }
+        bitfile->_bitcount -= number_of_bits;
+        BF_COUNT(bitfile, bits_read, number_of_bits);
+        return bits;
+    }
+    return bfrefillbits(bitfile, number_of_bits);
+}
+
+static inline int64_t bfgetsbits(BITFILE* bitfile, unsigned number_of_bits)
+{
+    uint64_t bits = bfgetbits(bitfile, number_of_bits);
+    if (number_of_bits - 1 >= BITBUF_LEN - 1) return (int64_t)bits;
+
+    unsigned shift = BITBUF_LEN - number_of_bits;
+    return (int64_t)(bits << shift) >> shift;
+}
+
+static inline uint64_t bfpeekbits(BITFILE* bitfile, unsigned number_of_bits)
+{
+    if (number_of_bits - 1 < bitfile->_bitcount &&
+        (bitfile->_flags & (BF_FLAG_READ | BF_FLAG_DIRTY | BF_FLAG_EOF)) == BF_FLAG_READ)
+    {
+        if (BF_TOP_FIRST(bitfile->_flags)) return bitfile->_bitbuf >> (BITBUF_LEN - number_of_bits);
+        if (number_of_bits == BITBUF_LEN)  return bitfile->_bitbuf;
+        return bitfile->_bitbuf & ((UINT64_C(1) << number_of_bits) - 1);
+    }
+    return bfrefillpeek(bitfile, number_of_bits);
+}
+
+static inline int bfskipbits(BITFILE* bitfile, bsize_t number_of_bits)
+{
+    /* Drop bits from the accumulator while it holds the whole skip */
+    if (number_of_bits <= bitfile->_bitcount &&
+        (bitfile->_flags & (BF_FLAG_READ | BF_FLAG_DIRTY | BF_FLAG_EOF)) == BF_FLAG_READ)
+    {
+        if (number_of_bits == BITBUF_LEN)          bitfile->_bitbuf = 0;
+        else if (BF_TOP_FIRST(bitfile->_flags))    bitfile->_bitbuf <<= number_of_bits;
+        else                                       bitfile->_bitbuf >>= number_of_bits;
+        bitfile->_bitcount -= number_of_bits;
+        return 0;
+    }
+    return bfrefillskip(bitfile, number_of_bits);
+}
+
+static inline int bfputbits(BITFILE* bitfile, uint64_t value, unsigned number_of_bits)
+{
+    /* Append straight to the accumulator while it is pending output & has room */
+    if (number_of_bits && number_of_bits <= (unsigned)(BITBUF_LEN - bitfile->_bitcount) &&
+        (bitfile->_flags & (BF_FLAG_WRITE | BF_FLAG_DIRTY)) == (BF_FLAG_WRITE | BF_FLAG_DIRTY))
+    {
+        if (number_of_bits < BITBUF_LEN) value &= (UINT64_C(1) << number_of_bits) - 1;
+
+        if (bitfile->_flags & BF_FLAG_MSB) bitfile->_bitbuf |= value << (BITBUF_LEN - number_of_bits - bitfile->_bitcount);
+        else                               bitfile->_bitbuf |= value << bitfile->_bitcount;
+        bitfile->_bitcount += number_of_bits;
+        BF_COUNT(bitfile, bits_written, number_of_bits);
+        return number_of_bits;
+    }
+    return bfspillbits(bitfile, value, number_of_bits);
+}
+
+static inline int bfputsbits(BITFILE* bitfile, int64_t value, unsigned number_of_bits)
+{
+    return bfputbits(bitfile, (uint64_t)value, number_of_bits);
+}
+
+
 #endif
\ No newline at end of file
@@ -21,6 +21,7 @@ int printTest(byte_t* bin, bsize_t bitcount, const char* expected);
 int swapTest(int size, byte_t* expected);
 int freeprint();
 int expectError(int code);
+void traceCount(BITFILE* bitfile, int op, bool end, void* counts);
 
 
 /* Run all tests */
@@ -105,6 +106,18 @@ int main()
     if (writeTest(">64 bit", TEST_FILE_W, false, k, 1, 9, krl)) return 1;
     if (writeTest(">64 bit", TEST_FILE_W,  true, k, 1, 9, krm)) return 1;
 
+    bsize_t l[] = {5,64,27,64,1};
+    byte_t lrl[][8] = {{21}, {testtext[0], testtext[1], testtext[2], testtext[3], testtext[4], testtext[5], testtext[6], testtext[7]}, {testtext[4], testtext[5], testtext[6], 5}, {1, 2, 3, 4, 5, 6, 7, 8}, {1}};
+    byte_t lrm[][8] = {{21}, {testtext[0], testtext[1], testtext[2], testtext[3], testtext[4], testtext[5], testtext[6], testtext[7]}, {testtext[4], testtext[5], testtext[6], 5}, {1, 2, 3, 4, 5, 6, 7, 8}, {1}};
+    if (writeTest("Multi-Word", TEST_FILE_W, false, l, 5, 8, lrl)) return 1;
+    if (writeTest("Multi-Word", TEST_FILE_W,  true, l, 5, 8, lrm)) return 1;
+
+    bsize_t m[] = {3,5,128,4,4,96};
+    byte_t mrl[][16] = {{5}, {21}, {'a','b','c','d','e','f','g','h','i','j','k','l','m','n','o','p'}, {9}, {6}, {'q','r','s','t','u','v','w','x','y','z','!','?'}};
+    byte_t mrm[][16] = {{5}, {21}, {'a','b','c','d','e','f','g','h','i','j','k','l','m','n','o','p'}, {9}, {6}, {'q','r','s','t','u','v','w','x','y','z','!','?'}};
+    if (writeTest("Bulk Byte", TEST_FILE_W, false, m, 6, 16, mrl)) return 1;
+    if (writeTest("Bulk Byte", TEST_FILE_W,  true, m, 6, 16, mrm)) return 1;
+
 
 
     /* FILE OPS */
@@ -124,6 +137,7 @@ int main()
     }
     else if (VERBOSE) printf("    SUCCESS: File Close subtest.\n");
 
+    bfpos_t pos;
     char name[15] = ".testXXXXXX";
     char namesuff[25];
     bf = tmpbitfile(name, false);
@@ -280,6 +294,819 @@ int main()
 
 
 
+    /* DESCRIPTOR BACKEND */
+
+    printf("%02d) Descriptor backend tests\n", testCount++);
+
+    if (VERBOSE) printf("  - Descriptor read subtest.\n");
+    bf = bfopen(TEST_FILE_R, "rd", false);
+    if (bf == NULL)
+    {
+        perror("  FAILED: Unable to open file with descriptor backend");
+        return 1;
+    }
+    if (checkRead("- Descriptor Read", bf, 8, testtext)) return 1;
+    if (bfseek(bf, 12, SEEK_CUR) || bftell(bf) != 20)
+    {
+        printf("  FAILED: Descriptor seek ended at %"BPOS_T_STR" (Expected 20).\n", bftell(bf));
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Descriptor small buffer subtest.\n");
+    bf = bfopen(TEST_FILE_W, "w+d", true);
+    if (setbfbuf(bf, NULL, _IOFBF, 3))
+    {
+        perror("  FAILED: Unable to set descriptor buffer");
+        bfclose(bf);
+        return 1;
+    }
+    if (bfwrite(&testtext[0], 5, bf) != 5 || bfwrite(&testtext[1], 64, bf) != 64)
+    {
+        perror("  FAILED: Unable to write through descriptor buffer");
+        bfclose(bf);
+        return 1;
+    }
+    bfrewind(bf);
+    byte_t fdtext[] = { testtext[0] & 0x1F };
+    if (checkRead("- Descriptor Head", bf, 5, fdtext)) return 1;
+    if (checkRead("- Descriptor Body", bf, 64, &testtext[1])) return 1;
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Descriptor write-behind subtest.\n");
+    bf = bfopen(TEST_FILE_W, "w+d", true);
+    if (setbfbuf(bf, NULL, _IOFBF, 2) || bfadvise(bf, BF_ADVISE_WRITEBEHIND))
+    {
+        perror("  FAILED: Unable to start write-behind");
+        bfclose(bf);
+        return 1;
+    }
+    if (bfwrite(&testtext[0], 5, bf) != 5 || bfwrite(&testtext[1], 64, bf) != 64 || bfflush(bf))
+    {
+        perror("  FAILED: Unable to write behind descriptor buffer");
+        bfclose(bf);
+        return 1;
+    }
+    bfrewind(bf);
+    if (checkRead("- Write-behind Head", bf, 5, fdtext)) return 1;
+    if (checkRead("- Write-behind Body", bf, 64, &testtext[1])) return 1;
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Descriptor read-ahead subtest.\n");
+    bf = bfopen(TEST_FILE_W, "rd", true);
+    if (setbfbuf(bf, NULL, _IOFBF, 2) || bfadvise(bf, BF_ADVISE_READAHEAD))
+    {
+        perror("  FAILED: Unable to start read-ahead");
+        bfclose(bf);
+        return 1;
+    }
+    if (checkRead("- Read-ahead Head", bf, 5, fdtext)) return 1;
+    if (checkRead("- Read-ahead Body", bf, 32, &testtext[1])) return 1;
+    bfseek(bf, 5 + 48, SEEK_SET);
+    if (bfadvise(bf, BF_ADVISE_NORMAL) || checkRead("- Read-ahead Stopped", bf, 16, &testtext[7])) return 1;
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Descriptor append subtest.\n");
+    byte_t appended[] = { 11, 22, 33, 44, 55 };
+    bfclose(bfopen(TEST_FILE_W, "wd", false));
+    bf = bfopen(TEST_FILE_W, "ad", false);
+    bfwrite(&appended[0], 16, bf);
+    bfflush(bf);
+    bfwrite(&appended[2], 16, bf);
+    bfclose(bf);
+    bf = bfopen(TEST_FILE_W, "a+d", false);
+    bfrewind(bf);
+    if (checkRead("- Append Reread", bf, 8, appended)) return 1;
+    bfwrite(&appended[4], 8, bf);
+    bfclose(bf);
+    bf = bfopen(TEST_FILE_W, "rd", false);
+    if (checkRead("- Appended", bf, 40, appended)) return 1;
+    if (bfgetbits(bf, 8) != 0 || !bfeof(bf))
+    {
+        printf("  FAILED: Appended bytes were written more than once.\n");
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+    printf("  SUCCESS: Descriptor backend subtests passed.\n");
+
+
+
+    /* MAPPED BACKEND */
+
+    printf("%02d) Mapped backend tests\n", testCount++);
+
+    if (VERBOSE) printf("  - Mapped read subtest.\n");
+    bf = bfopen(TEST_FILE_R, "rm", true);
+    if (bf == NULL || bfadvise(bf, BF_ADVISE_RANDOM))
+    {
+        perror("  FAILED: Unable to map file");
+        return 1;
+    }
+    bfseek(bf, 10, SEEK_SET);
+    if (checkPosition("Map Seek", bf, 1, 2, 0)) return 1;
+    pos = (bfpos_t){ 1, 0 };
+    if (checkPosition("Map SetPos", bf, 1, 0, bfsetpos(bf, &pos))) return 1;
+    if (checkRead("- Mapped Read", bf, 24, &testtext[1])) return 1;
+
+    if (VERBOSE) printf("  - Mapped EOF subtest.\n");
+    if (bfread(&res, 8, bf) != 0 || !bfeof(bf))
+    {
+        printf("  FAILED: Read past end of mapping.\n");
+        bfclose(bf);
+        return 1;
+    }
+    if (bfwrite(&res, 8, bf) != 0 || !bferror(bf))
+    {
+        printf("  FAILED: Wrote to read-only mapping.\n");
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Mapped write mode subtest.\n");
+    if (bfopen(TEST_FILE_R, "r+m", true) != NULL || errno != EINVAL)
+    {
+        printf("  FAILED: Opened writable mapping.\n");
+        return 1;
+    }
+    printf("  SUCCESS: Mapped backend subtests passed.\n");
+
+
+
+    /* MEMORY BACKEND */
+
+    printf("%02d) Memory backend tests\n", testCount++);
+
+    if (VERBOSE) printf("  - Memory read subtest.\n");
+    bf = bfmemopen(testtext, 4, "r", false);
+    if (checkRead("- Memory Read", bf, 32, testtext)) return 1;
+    if (bfread(&res, 1, bf) != 0 || !bfeof(bf))
+    {
+        printf("  FAILED: Read past end of memory.\n");
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Growable memory subtest.\n");
+    bf = bfmemopen(NULL, 1, "w+", true);
+    for (int n = 0; n < 9; n++)
+    {
+        if (bfwrite(&testtext[n], n == 8 ? 2 : 8, bf) != (n == 8 ? 2 : 8))
+        {
+            perror("  FAILED: Unable to write to growable memory");
+            bfclose(bf);
+            return 1;
+        }
+    }
+    size_t memsize = 0;
+    byte_t* membuf = bfmembuf(bf, &memsize);
+    if (memsize != 9 || memcmp(membuf, testtext, 8) || membuf[8] != 0x80)
+    {
+        printf("  FAILED: Memory holds %zu bytes (Expected 9).\n", memsize);
+        bfclose(bf);
+        return 1;
+    }
+    bfrewind(bf);
+    if (checkRead("- Growable Read", bf, 66, testtext)) return 1;
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Fixed memory overflow subtest.\n");
+    byte_t fixed[2];
+    bf = bfmemopen(fixed, sizeof(fixed), "w", false);
+    bfwrite(testtext, 24, bf);
+    if (bfflush(bf) == 0 || !bferror(bf) || errno != ENOSPC)
+    {
+        printf("  FAILED: Wrote past end of fixed memory.\n");
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+    printf("  SUCCESS: Memory backend subtests passed.\n");
+
+
+
+    /* PARTIAL OVERWRITE */
+
+    printf("%02d) Overwrite tests\n", testCount++);
+
+    bf = bfopen(TEST_FILE_W, "w+", true);
+    bfwrite(testtext, 32, bf);
+
+    if (VERBOSE) printf("  - Mid-byte overwrite subtest.\n");
+    byte_t patch[] = { 5, 0 };
+    bfseek(bf, 5, SEEK_SET);
+    if (bfwrite(&patch[0], 3, bf) != 3)
+    {
+        perror("  FAILED: Unable to overwrite byte tail");
+        bfclose(bf);
+        return 1;
+    }
+    bfseek(bf, 10, SEEK_SET);
+    if (bfwrite(&patch[1], 6, bf) != 6)
+    {
+        perror("  FAILED: Unable to overwrite byte head");
+        bfclose(bf);
+        return 1;
+    }
+
+    bfrewind(bf);
+    byte_t overwritten[] = { 'u', '@', 'v', 'w' };
+    if (checkRead("- Overwrite", bf, 32, overwritten)) return 1;
+    bfclose(bf);
+    printf("  SUCCESS: Overwrite subtests passed.\n");
+
+
+
+    printf("%02d) Positional I/O tests\n", testCount++);
+
+    bf = bfopen(TEST_FILE_W, "w+d", true);
+    bfwrite(testtext, 32, bf);
+    bfflush(bf);
+    bfseek(bf, 8, SEEK_SET);
+
+    if (VERBOSE) printf("  - Positional overwrite subtest.\n");
+    if (bfpwrite(bf, &patch[0], 3, 5) != 3 || bfpwrite(bf, &patch[1], 6, 10) != 6)
+    {
+        perror("  FAILED: Unable to write at bit offset");
+        bfclose(bf);
+        return 1;
+    }
+    byte_t positional[4];
+    if (bfpread(bf, positional, 32, 0) != 32 || memcmp(positional, overwritten, 4))
+    {
+        printf("  FAILED: Positional read did not match overwrite.\n");
+        bfclose(bf);
+        return 1;
+    }
+
+    if (VERBOSE) printf("  - Positional read subtest.\n");
+    if (bfpread(bf, positional, 12, 4) != 12 || positional[0] != 'T' || positional[1] != 0 ||
+        bfpread(bf, positional, 16, 28) != 4 || positional[0] != ('w' & 0xF) || positional[1] != 0)
+    {
+        printf("  FAILED: Unaligned positional read: %02x %02x.\n", positional[0], positional[1]);
+        bfclose(bf);
+        return 1;
+    }
+    if (checkPosition("Cursor unmoved", bf, 1, 0, 0)) return 1;
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Positional write over buffer subtest.\n");
+    byte_t filler[100], solid = 0x55, half = 0x5;
+    memset(filler, 0xAA, sizeof(filler));
+    bf = bfopen(TEST_FILE_W, "w+d", true);
+    bfwrite(filler, 800, bf);
+    bfflush(bf);
+    bfpwrite(bf, &solid, 8, 400);
+    bfwrite(filler, 8, bf);
+    bfpwrite(bf, &half, 4, 408);
+    bfseek(bf, 400, SEEK_SET);
+    if (bfgetbits(bf, 16) != 0x555A)
+    {
+        printf("  FAILED: Cursor read buffered bytes from before positional writes.\n");
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+    bf = bfopen(TEST_FILE_W, "r", true);
+    bfseek(bf, 400, SEEK_SET);
+    if (bfgetbits(bf, 16) != 0x555A)
+    {
+        printf("  FAILED: Flushing the buffer undid positional writes.\n");
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+    printf("  SUCCESS: Positional I/O subtests passed.\n");
+
+
+
+    printf("%02d) Range Handle tests\n", testCount++);
+
+    const char* rangeModes[] = { "r", "rd", "rm" };
+    bpos_t bounds[] = { 4, 12, 20 };
+    BITFILE* shards[2];
+    for (int m = 0; m < 3; m++)
+    {
+        if (VERBOSE) printf("  - Split '%s' subtest.\n", rangeModes[m]);
+        bf = bfopen(TEST_FILE_R, rangeModes[m], true);
+        if (bf == NULL || bfsplit(bf, bounds, 2, shards))
+        {
+            perror("  FAILED: Unable to split file");
+            if (bf != NULL) bfclose(bf);
+            return 1;
+        }
+
+        /* Each handle starts at its bound & stops at the byte holding its last bit */
+        for (int n = 0; n < 2; n++)
+        {
+            byte_t expected = 0;
+            bfpread(bf, &expected, 8, bounds[n]);
+            uint64_t field = bfgetbits(shards[n], 8);
+            if (field != expected || bfeof(shards[n]))
+            {
+                printf("  FAILED: Handle %d expected: %02x, got: %02llx.\n", n, expected, (unsigned long long)field);
+                return 1;
+            }
+        }
+        bfgetbits(shards[1], 4);
+        if (bfeof(shards[1]) || (bfgetbits(shards[1], 1), !bfeof(shards[1])))
+        {
+            printf("  FAILED: Handle did not stop at end of range.\n");
+            return 1;
+        }
+
+        for (int n = 0; n < 2; n++) bfclose(shards[n]);
+        if (bfgetbits(bf, 8) != testtext[0])
+        {
+            printf("  FAILED: Closing handles disturbed the file.\n");
+            bfclose(bf);
+            return 1;
+        }
+        bfclose(bf);
+    }
+    printf("  SUCCESS: Range Handle subtests passed.\n");
+
+
+
+    printf("%02d) Shared Append tests\n", testCount++);
+
+    unsigned recordWidths[] = { 5, 7, 12 };
+    uint16_t records[] = { 0x15, 0x2A, 0xB3C };
+    byte_t recordBytes[][2] = { { 0x15 }, { 0x2A }, { 0xB3, 0xC } };
+    for (int m = 0; m < 2; m++)
+    {
+        if (VERBOSE) printf("  - Shared %s subtest.\n", m ? "descriptor" : "memory");
+        bf = m ? bfopen(TEST_FILE_W, "w+d", true) : bfmemopen(NULL, 16, "w+", true);
+        bfputbits(bf, 0x5, 3);
+        if (bfshare(bf, true) || bfputbits(bf, 0x1, 1) || errno != EINVAL)
+        {
+            printf("  FAILED: Unable to share bitfile.\n");
+            bfclose(bf);
+            return 1;
+        }
+
+        /* Records are filled out of order, neighbours share bytes */
+        bpos_t starts[3];
+        for (int i = 0; i < 3; i++) starts[i] = bfreserve(bf, recordWidths[i]);
+        for (int i = 2; i >= 0; i--)
+        {
+            if (bfpwrite(bf, recordBytes[i], recordWidths[i], starts[i]) != recordWidths[i])
+            {
+                perror("  FAILED: Unable to write reserved record");
+                bfclose(bf);
+                return 1;
+            }
+        }
+        if (starts[0] != 3 || starts[2] != 15 || bfshare(bf, false) || bftell(bf) != 27)
+        {
+            printf("  FAILED: Records reserved at %"BPOS_T_STR", %"BPOS_T_STR" (Expected 3, 15).\n", starts[0], starts[2]);
+            bfclose(bf);
+            return 1;
+        }
+
+        bfrewind(bf);
+        if (bfgetbits(bf, 3) != 0x5 || bfgetbits(bf, 5) != records[0] || bfgetbits(bf, 7) != records[1] || bfgetbits(bf, 12) != records[2])
+        {
+            printf("  FAILED: Shared records did not merge.\n");
+            bfclose(bf);
+            return 1;
+        }
+        bfclose(bf);
+    }
+    printf("  SUCCESS: Shared Append subtests passed.\n");
+
+
+    printf("%02d) Bit Field tests\n", testCount++);
+
+    if (VERBOSE) printf("  - Integer read subtest.\n");
+    bf = bfopen(TEST_FILE_R, "r", true);
+    uint64_t field = bfgetbits(bf, 12);
+    if (field != 0x747)
+    {
+        printf("  FAILED: MSB-first bfgetbits expected: 747, got: %llx.\n", (unsigned long long)field);
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+    bf = bfopen(TEST_FILE_R, "r", false);
+    field = bfgetbits(bf, 12);
+    if (field != 0x574)
+    {
+        printf("  FAILED: LSB-first bfgetbits expected: 574, got: %llx.\n", (unsigned long long)field);
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Peek & skip subtest.\n");
+    bf = bfopen(TEST_FILE_R, "r", true);
+    field = bfpeekbits(bf, 12);
+    if (field != 0x747 || bfpeekbits(bf, 12) != field || bftell(bf) != 0)
+    {
+        printf("  FAILED: bfpeekbits moved the cursor or returned: %llx.\n", (unsigned long long)field);
+        bfclose(bf);
+        return 1;
+    }
+    bfskipbits(bf, 4);
+    field = bfgetbits(bf, 8);
+    if (field != 0x47)
+    {
+        printf("  FAILED: bfgetbits after bfskipbits expected: 47, got: %llx.\n", (unsigned long long)field);
+        bfclose(bf);
+        return 1;
+    }
+    if (bfskipbits(bf, 18) || bftell(bf) != 30 || bfgetbits(bf, 2) != 0x3)
+    {
+        printf("  FAILED: bfskipbits ended at bit %lld, expected 30.\n", bftell(bf));
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+
+    if (VERBOSE) printf("  - Wide peek subtest.\n");
+    for (int msb = 0; msb < 2; msb++)
+    {
+        bf = bfopen(TEST_FILE_W, "w", msb);
+        for (int i = 0; i < 256; i++) bfputbits(bf, (i * 37 + 11) & 0xFF, BYTE_LEN);
+        bfclose(bf);
+
+        /* Unaligned 64-bit peeks run past the accumulator into the next byte of the stdio stream */
+        bf = bfopen(TEST_FILE_W, "r", msb);
+        clearbfstats(bf);
+        for (int i = 0; bftell(bf) + 2 * BITBUF_LEN <= 256 * BYTE_LEN; i++)
+        {
+            bfgetbits(bf, 1 + i % 7);
+            field = bfpeekbits(bf, BITBUF_LEN);
+            uint64_t first = msb ? field >> 32 : field & 0xFFFFFFFF;
+            uint64_t second = msb ? field & 0xFFFFFFFF : field >> 32;
+            if (bfpeekbits(bf, BITBUF_LEN) != field || bfgetbits(bf, 32) != first || bfgetbits(bf, 32) != second)
+            {
+                printf("  FAILED: %s-first 64-bit peek %d did not match the bits read after it.\n", msb ? "MSB" : "LSB", i);
+                bfclose(bf);
+                return 1;
+            }
+        }
+#if BF_STATS
+        bfstats_t peekStats;
+        if (bfstats(bf, &peekStats) || peekStats.file_seeks)
+        {
+            printf("  FAILED: 64-bit peeks seeked the stdio stream %"BSIZE_T_STR" times.\n", (bsize_t)peekStats.file_seeks);
+            bfclose(bf);
+            return 1;
+        }
+#endif
+        bfclose(bf);
+    }
+
+    for (int msb = 0; msb < 2; msb++)
+    {
+        if (VERBOSE) printf("  - %s-first round trip subtest.\n", msb ? "MSB" : "LSB");
+        bf = bfopen(TEST_FILE_W, "w+", msb);
+        for (unsigned width = 1; width <= BITBUF_LEN; width++)
+        {
+            bfputbits(bf, UINT64_C(0x9E3779B97F4A7C15) * width, width);
+            bfputsbits(bf, -(int64_t)width, 7);
+        }
+        bfrewind(bf);
+        for (unsigned width = 1; width <= BITBUF_LEN; width++)
+        {
+            uint64_t expected = UINT64_C(0x9E3779B97F4A7C15) * width;
+            if (width < BITBUF_LEN) expected &= (UINT64_C(1) << width) - 1;
+            if (bfgetbits(bf, width) != expected || bfgetsbits(bf, 7) != -(int64_t)width)
+            {
+                printf("  FAILED: %u-bit field did not round trip.\n", width);
+                bfclose(bf);
+                return 1;
+            }
+        }
+        if (bfgetbits(bf, 8) != 0 || !bfeof(bf))
+        {
+            printf("  FAILED: Reading bit field past end did not reach EOF.\n");
+            bfclose(bf);
+            return 1;
+        }
+        bfclose(bf);
+    }
+    printf("  SUCCESS: Bit Field subtests passed.\n");
+
+
+    printf("%02d) Variable-Length Code tests\n", testCount++);
+
+    for (int msb = 1; msb >= 0; msb--)
+    {
+        if (VERBOSE) printf("  - %s-first code subtest.\n", msb ? "MSB" : "LSB");
+        bf = bfmemopen(NULL, 0, "w+", msb);
+        bsize_t codeBits = bfputexpgolomb(bf, 3, 0) + bfputgamma(bf, 5) + bfputdelta(bf, 10) + bfputrice(bf, 9, 2) + bfputunary(bf, 3);
+        if (codeBits != 27)
+        {
+            printf("  FAILED: Expected 27 bits of codes, wrote %" BSIZE_T_STR ".\n", codeBits);
+            bfclose(bf);
+            return 1;
+        }
+
+        /* 00100 00101 00100010 00101 0001 */
+        size_t size;
+        byte_t codes[] = { 0x21, 0x48, 0x8A, 0x20 };
+        bfflush(bf);
+        if (msb && memcmp(bfmembuf(bf, &size), codes, sizeof(codes)))
+        {
+            printf("  FAILED: Codes were not written in standard form.\n");
+            bfclose(bf);
+            return 1;
+        }
+
+        bfrewind(bf);
+        if (bfgetexpgolomb(bf, 0) != 3 || bfgetgamma(bf) != 5 || bfgetdelta(bf) != 10 || bfgetrice(bf, 2) != 9 || bfgetunary(bf) != 3)
+        {
+            printf("  FAILED: Codes did not read back.\n");
+            bfclose(bf);
+            return 1;
+        }
+        bfclose(bf);
+    }
+    printf("  SUCCESS: Variable-Length Code subtests passed.\n");
+
+    printf("%02d) Prefix Code tests\n", testCount++);
+
+    /* Codes: 00 01 100 101 110 1110 1111 */
+    uint8_t lengths[] = { 2, 2, 3, 3, 3, 4, 4 };
+    uint16_t message[] = { 6, 0, 3, 5, 1, 2, 4, 6, 5 };
+    for (int msb = 1; msb >= 0; msb--)
+    {
+        if (VERBOSE) printf("  - %s-first encode & decode subtest.\n", msb ? "MSB" : "LSB");
+        bfhuff_t* huff = bfhuffbuild(lengths, 7, msb, 2);
+        if (huff == NULL)
+        {
+            printf("  FAILED: Unable to build prefix code table.\n");
+            return 1;
+        }
+
+        bf = bfmemopen(NULL, 0, "w+", msb);
+        bsize_t codeBits = 0;
+        for (unsigned i = 0; i < 9; i++) codeBits += bfencodesym(bf, huff, message[i]);
+        if (codeBits != 29)
+        {
+            printf("  FAILED: Expected 29 bits of codes, wrote %" BSIZE_T_STR ".\n", codeBits);
+            bfclose(bf);
+            bfhufffree(huff);
+            return 1;
+        }
+
+        /* 1111 00 101 1110 01 100 110 1111 1110 */
+        size_t size;
+        byte_t codes[] = { 0xF2, 0xF3, 0x37, 0xF0 };
+        bfflush(bf);
+        if (msb && memcmp(bfmembuf(bf, &size), codes, sizeof(codes)))
+        {
+            printf("  FAILED: Codes were not written in canonical form.\n");
+            bfclose(bf);
+            bfhufffree(huff);
+            return 1;
+        }
+
+        bfrewind(bf);
+        uint16_t symbols[8];
+        int first = bfdecodesym(bf, huff);
+        size_t count = bfdecodesyms(bf, huff, symbols, 8);
+        if (first != message[0] || count != 8 || memcmp(symbols, message + 1, sizeof(message) - sizeof(*message)))
+        {
+            printf("  FAILED: Symbols did not decode back (%zu of 8 read).\n", count);
+            bfclose(bf);
+            bfhufffree(huff);
+            return 1;
+        }
+        bfclose(bf);
+        bfhufffree(huff);
+    }
+
+    /* Codes: 0 10 110 111, message fills exactly one byte */
+    uint8_t endLengths[] = { 1, 2, 3, 3 };
+    uint16_t endMessage[] = { 3, 3, 1 };
+    for (int msb = 1; msb >= 0; msb--)
+    {
+        if (VERBOSE) printf("  - %s-first decode to EOF subtest.\n", msb ? "MSB" : "LSB");
+        bfhuff_t* huff = bfhuffbuild(endLengths, 4, msb, 0);
+        bf = bfmemopen(NULL, 0, "w+", msb);
+        for (unsigned i = 0; i < 3; i++) bfencodesym(bf, huff, endMessage[i]);
+        bfrewind(bf);
+
+        uint16_t symbols[10];
+        size_t count = bfdecodesyms(bf, huff, symbols, 10);
+        if (count != 3 || memcmp(symbols, endMessage, sizeof(endMessage)) || !bfeof(bf) || bftell(bf) != 8)
+        {
+            printf("  FAILED: Decoded %zu of 3 symbols, ending at bit %" BPOS_T_STR ".\n", count, bftell(bf));
+            bfclose(bf);
+            bfhufffree(huff);
+            return 1;
+        }
+        bfclose(bf);
+        bfhufffree(huff);
+    }
+
+    if (VERBOSE) printf("  - Invalid lengths subtest.\n");
+    uint8_t oversubscribed[] = { 1, 1, 1 };
+    if (bfhuffbuild(oversubscribed, 3, true, 0) != NULL)
+    {
+        printf("  FAILED: Built a table from over-subscribed code lengths.\n");
+        return 1;
+    }
+    printf("  SUCCESS: Prefix Code subtests passed.\n");
+
+    printf("%02d) Range Coder tests\n", testCount++);
+
+    for (int msb = 1; msb >= 0; msb--)
+    {
+        if (VERBOSE) printf("  - %s-first encode & decode subtest.\n", msb ? "MSB" : "LSB");
+        bfrange_t coder;
+        bfprob_t probs[2];
+        bfprobinit(probs, 2);
+
+        /* Both contexts are mostly 0 bits, with 1 bits at different rates */
+        bf = bfmemopen(NULL, 0, "w+", msb);
+        bfputbits(bf, 0x5, 3);
+        bfrangeenc(&coder, bf);
+        for (unsigned i = 0; i < 1000; i++) bfencbit(&coder, probs + (i & 1), i & 1 ? (i >> 1) % 5 == 0 : i % 7 == 0);
+        if (bfrangeflush(&coder))
+        {
+            printf("  FAILED: Unable to write coded bits.\n");
+            bfclose(bf);
+            return 1;
+        }
+        bpos_t end = bftell(bf);
+        bfputbits(bf, 0x5, 3);
+        if (end - 3 >= 1000)
+        {
+            printf("  FAILED: 1000 coded bits took %" BPOS_T_STR " bits.\n", end - 3);
+            bfclose(bf);
+            return 1;
+        }
+
+        bfrewind(bf);
+        bfprobinit(probs, 2);
+        bfskipbits(bf, 3);
+        bfrangedec(&coder, bf);
+        for (unsigned i = 0; i < 1000; i++)
+        {
+            int expected = i & 1 ? (i >> 1) % 5 == 0 : i % 7 == 0;
+            int bit = bfdecbit(&coder, probs + (i & 1));
+            if (bit == expected) continue;
+            printf("  FAILED: Coded bit %u expected: %d, got: %d.\n", i, expected, bit);
+            bfclose(bf);
+            return 1;
+        }
+        if (bftell(bf) != end || bfgetbits(bf, 3) != 0x5)
+        {
+            printf("  FAILED: Decoder did not stop at the end of the coded stream.\n");
+            bfclose(bf);
+            return 1;
+        }
+        bfclose(bf);
+    }
+
+    if (VERBOSE) printf("  - Write-only decode subtest.\n");
+    bfrange_t writeOnly;
+    bf = bfmemopen(NULL, 0, "w", true);
+    errno = 0;
+    if (bfrangedec(&writeOnly, bf) != EOF || !bferror(bf) || errno != EBADF)
+    {
+        printf("  FAILED: Started decoding from a write-only bitfile <%d>.\n", errno);
+        bfclose(bf);
+        return 1;
+    }
+    bfclose(bf);
+    printf("  SUCCESS: Range Coder subtests passed.\n");
+
+    printf("%02d) Packed Array tests\n", testCount++);
+
+    for (int msb = 0; msb < 2; msb++)
+    {
+        if (VERBOSE) printf("  - %s-first pack & unpack subtest.\n", msb ? "MSB" : "LSB");
+        uint32_t values[101];
+        for (unsigned i = 0; i < 100; i++) values[i] = i * 37 | 0xE000;
+
+        bf = bfmemopen(NULL, 0, "w+", msb);
+        bfputbits(bf, 0x5, 3);
+        if (bfwritepacked(bf, values, 100, 13) != 100)
+        {
+            printf("  FAILED: Unable to write packed values.\n");
+            bfclose(bf);
+            return 1;
+        }
+        bfrewind(bf);
+
+        bfskipbits(bf, 3);
+        size_t count = bfreadpacked(bf, values, 2, 13);
+        count += bfreadpacked(bf, values + count, 99, 13);
+        if (count != 100)
+        {
+            printf("  FAILED: Expected 100 packed values before EOF, got %zu.\n", count);
+            bfclose(bf);
+            return 1;
+        }
+        for (unsigned i = 0; i < count; i++)
+        {
+            if (values[i] == i * 37) continue;
+            printf("  FAILED: Packed value %u expected: %u, got: %u.\n", i, i * 37, values[i]);
+            bfclose(bf);
+            return 1;
+        }
+        bfclose(bf);
+    }
+
+    if (VERBOSE) printf("  - Portable & CPU kernels subtest.\n");
+    int kernels = bfkernels(BF_KERNEL_ALL);
+    for (unsigned width = 1; width <= 32; width++)
+    {
+        /* Pack with one kernel set & unpack with the other */
+        for (int cpuWrite = 0; cpuWrite < 2; cpuWrite++)
+        {
+            uint32_t values[300];
+            for (unsigned i = 0; i < 300; i++) values[i] = i * 2654435761u;
+
+            bf = bfmemopen(NULL, 0, "w+", width % 2);
+            bfputbits(bf, 0x5, width % 5);
+            bfkernels(cpuWrite ? kernels : 0);
+            size_t count = bfwritepacked(bf, values, 300, width);
+            bfrewind(bf);
+            bfskipbits(bf, width % 5);
+            bfkernels(cpuWrite ? 0 : kernels);
+            count += bfreadpacked(bf, values, 300, width);
+            bfclose(bf);
+
+            uint32_t mask = width < 32 ? (1u << width) - 1 : UINT32_MAX;
+            for (unsigned i = 0; i < 300 && count == 600; i++)
+            {
+                if (values[i] != ((i * 2654435761u) & mask)) count = i;
+            }
+            if (count != 600)
+            {
+                printf("  FAILED: %u-bit values differ between portable & CPU kernels (0x%X) at %zu.\n", width, kernels, count);
+                bfkernels(BF_KERNEL_ALL);
+                return 1;
+            }
+        }
+    }
+    bfkernels(BF_KERNEL_ALL);
+    printf("  SUCCESS: Packed Array subtests passed.\n");
+
+
+
+    printf("%02d) Backward Read tests\n", testCount++);
+
+    unsigned widths[] = { 3, 17, 1, 64, 9 };
+    uint64_t fields[] = { 0x5, 0x1ABCD, 0x1, 0xFEDCBA9876543210, 0x123 };
+    for (int msb = 1; msb >= 0; msb--)
+    {
+        if (VERBOSE) printf("  - %s-first reverse subtest.\n", msb ? "MSB" : "LSB");
+        bf = bfmemopen(NULL, 0, "w+", msb);
+        for (unsigned i = 0; i < 5; i++) bfputbits(bf, fields[i], widths[i]);
+
+        /* Fields come back last to first */
+        if (bfreverse(bf, true) || bfseek(bf, 94, SEEK_SET))
+        {
+            printf("  FAILED: Unable to start reading backward.\n");
+            bfclose(bf);
+            return 1;
+        }
+        for (int i = 4; i >= 0; i--)
+        {
+            uint64_t field = bfgetbits(bf, widths[i]);
+            if (field == fields[i]) continue;
+            printf("  FAILED: Field %d expected: %llx, got: %llx.\n", i, (unsigned long long)fields[i], (unsigned long long)field);
+            bfclose(bf);
+            return 1;
+        }
+        if (bftell(bf) != 0 || bfeof(bf) || (bfgetbits(bf, 1), !bfeof(bf)))
+        {
+            printf("  FAILED: Backward reads did not stop at the start of file.\n");
+            bfclose(bf);
+            return 1;
+        }
+        if (bfputbits(bf, 0x1, 1))
+        {
+            printf("  FAILED: Wrote while reading backward.\n");
+            bfclose(bf);
+            return 1;
+        }
+
+        if (VERBOSE) printf("  - %s-first direction switch subtest.\n", msb ? "MSB" : "LSB");
+        bfseek(bf, 21, SEEK_SET);
+        bfskipbits(bf, 1);
+        if (bfpeekbits(bf, 17) != fields[1] || bfreverse(bf, false) || bftell(bf) != 20 || bfgetbits(bf, 1) != fields[2])
+        {
+            printf("  FAILED: Cursor moved when switching direction.\n");
+            bfclose(bf);
+            return 1;
+        }
+        bfclose(bf);
+    }
+    printf("  SUCCESS: Backward Read subtests passed.\n");
+
+
+
     /* FILE POSITION */
 
     printf("%02d) Position tests\n", testCount++);
@@ -314,7 +1141,7 @@ int main()
 
 
     if (VERBOSE) printf("  - bfsetpos subtest.\n");
-    bfpos_t pos = {0, 3};
+    pos = (bfpos_t){0, 3};
     res = bfsetpos(bf, &pos);
     if (checkPosition("Bit only", bf, 0, 3, res)) return 1;
 
@@ -424,6 +1251,69 @@ int main()
 
 
 
+    /* STATISTICS */
+
+    printf("%02d) Statistics tests\n", testCount++);
+    bf = bfmemopen(testtext, sizeof(testtext), "r", true);
+    bfstats_t stats;
+
+#if BF_STATS
+    if (VERBOSE) printf("  - Count subtest.\n");
+    bfgetbits(bf, 13);
+    bfread(buff, 3, bf);
+    bfseek(bf, 0, SEEK_END);
+    bfgetbits(bf, 1);
+    if (bfstats(bf, &stats) || stats.bits_read != 16 || stats.bytes_read != BITBUF_LEN / BYTE_LEN || !stats.buffer_seeks || stats.eofs != 1)
+    {
+        printf("  FAILED: Counted %"BSIZE_T_STR" bits, %"BSIZE_T_STR" bytes & %"BSIZE_T_STR" EOFs (Expected 16, %d & 1).\n",
+               (bsize_t)stats.bits_read, (bsize_t)stats.bytes_read, (bsize_t)stats.eofs, BITBUF_LEN / BYTE_LEN);
+        bfclose(bf);
+        return 1;
+    }
+
+    if (VERBOSE) printf("  - Clear subtest.\n");
+    clearbfstats(bf);
+    if (bfstats(bf, &stats) || stats.bits_read || stats.bytes_read || stats.buffer_seeks || stats.eofs)
+    {
+        printf("  FAILED: Statistics not cleared.\n");
+        bfclose(bf);
+        return 1;
+    }
+
+    if (VERBOSE) printf("  - Trace subtest.\n");
+    int traced[BF_OPS] = { 0 };
+    bflatency_t latency;
+    bftrace(bf, traceCount, traced);
+    bftimeops(bf, true);
+    bfseek(bf, 0, SEEK_SET);
+    bfread(buff, 8, bf);
+    bfread(buff, 8, bf);
+    bftrace(bf, NULL, NULL);
+    bfread(buff, 8, bf);
+
+    uint64_t timed = 0;
+    if (bflatency(bf, &latency) == 0) for (int i = 0; i < BF_LATENCY_BUCKETS; i++) timed += latency.buckets[BF_OP_READ][i];
+    if (traced[BF_OP_READ] != 2 || traced[BF_OP_SEEK] != 1 || timed != 3)
+    {
+        printf("  FAILED: Traced %d reads & %d seeks, timed %d reads (Expected 2, 1 & 3).\n", traced[BF_OP_READ], traced[BF_OP_SEEK], (int)timed);
+        bfclose(bf);
+        return 1;
+    }
+#else
+    if (VERBOSE) printf("  - Compiled out subtest.\n");
+    if (bfstats(bf, &stats) != -1 || errno != ENOTSUP)
+    {
+        printf("  FAILED: Statistics available without BF_STATS.\n");
+        bfclose(bf);
+        return 1;
+    }
+#endif
+
+    bfclose(bf);
+    printf("  SUCCESS: Statistics subtests passed.\n");
+
+
+
     /* UTILITIES */
 
     printf("%02d) Utility tests\n", testCount++);
@@ -646,7 +1536,7 @@ int checkRead(char* name, BITFILE *bf, bsize_t bitcount, byte_t* expected)
 {
     size_t bytecount = CEIL_DIV(bitcount, BYTE_LEN);
     byte_t result[bytecount];
-    for (int i = 0; i < bytecount; i++) result[i] = 0;
+    for (size_t i = 0; i < bytecount; i++) result[i] = 0;
 
     bsize_t rescount = bfread(result, bitcount, bf);
 
@@ -760,7 +1650,7 @@ void printNumber(byte_t* bin_data, bsize_t bit_width)
 /* Compare two arrays, returns 0 if equal */
 int arrcmp(byte_t* a, byte_t* b, size_t size)
 {
-    for (int i = 0; i < size; i++)
+    for (size_t i = 0; i < size; i++)
     {
         if (a[i] < b[i]) return -1;
         if (a[i] > b[i]) return 1;
@@ -768,6 +1658,13 @@ int arrcmp(byte_t* a, byte_t* b, size_t size)
     return 0;
 }
 
+/* Trace callback counting finished calls of each type into counts */
+void traceCount(BITFILE* bitfile, int op, bool end, void* counts)
+{
+    (void)bitfile;
+    if (end) ((int*)counts)[op]++;
+}
+
 /* Print <count> spaces */
 void printspaces(int count)
 {